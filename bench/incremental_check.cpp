@@ -0,0 +1,100 @@
+// Check of IncrementalEvaluator against a full raytrace + Scorer.
+//
+// Random moves of the lamp and single mirrors, most of them reverted again, are
+// applied to three layouts: a known good CMC24 solution with small moves (long
+// paths, tails retraced from deep inside), a random repaired solution with
+// large moves, and one with enough mirrors to use the BVH. After every move and
+// every revert the incremental path and score must equal those of tracing and
+// scoring the whole solution. Exits with 1 on any difference.
+// Build and run with: make check
+
+#include "../engine/IncrementalEvaluator.h"
+#include "../engine/Repair.h"
+#include <cstdio>
+#include <random>
+
+// Moves checked in one scenario, and the number of differences found
+static int checkMoves(const Temple &temple, const Lamp &lamp, const std::vector<Mirror> &mirrors, double positionStep,
+                      double angleStep, double revertRate, int moves, std::mt19937_64 &gen, const char *name)
+{
+    const int pixelsPerUnit = 20;
+    IncrementalEvaluator evaluator(temple, pixelsPerUnit);
+    Scorer scorer(temple, pixelsPerUnit);
+    evaluator.reset(lamp, mirrors);
+
+    std::normal_distribution<double> normal(0.0, 1.0);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    int differences = 0;
+    size_t reused = 0;
+    for (int k = 0; k < moves; ++k)
+    {
+        int element = (int)(gen() % (mirrors.size() + 1)) - 1;
+        Vector2 shift(normal(gen) * positionStep, normal(gen) * positionStep);
+        double turn = normal(gen) * angleStep;
+        if (element < 0)
+        {
+            const Lamp &current = evaluator.getLamp();
+            evaluator.moveLamp(current.v + shift, current.angle + turn);
+        }
+        else
+        {
+            const Mirror &current = evaluator.getMirrors()[element];
+            evaluator.moveMirror(element, current.v1 + shift, current.angle + turn);
+        }
+        reused += evaluator.lastReused();
+        if (uniform(gen) < revertRate)
+        {
+            evaluator.revert();
+        }
+
+        Path path = Validation::raytrace(temple, evaluator.getLamp(), evaluator.getMirrors());
+        double score = scorer.evaluatePath(path);
+        bool samePath = path.points == evaluator.getPath().points;
+        if (!samePath || score != evaluator.score())
+        {
+            if (differences < 5)
+            {
+                std::printf("  move %d (element %d): same path %d, full %.9f, incremental %.9f\n", k, element, samePath,
+                            score, evaluator.score());
+            }
+            ++differences;
+        }
+    }
+    std::printf("%-16s %zu mirrors, %d moves: %d differences, %.2f segments reused per move\n", name, mirrors.size(),
+                moves, differences, (double)reused / moves);
+    return differences;
+}
+
+int main()
+{
+    Temple temple;
+    SolutionSpace space(temple);
+    std::mt19937_64 gen(3);
+    int differences = 0;
+
+    // Known good layout, 72.2% at 20 pixels per unit
+    std::vector<std::vector<double>> solution = {
+        {9.976768, 6.016890, 1.0471975512}, {15.791869, 2.211458, 3.7367499285}, {6.270284, 4.788743, 5.5326937288},
+        {1.672089, 1.417875, 5.6529469143}, {10.159322, 12.587648, 0.1047197551}, {2.532963, 17.421005, 3.8397243544},
+        {17.278198, 18.943255, 5.5955255819}, {1.949380, 13.379882, 1.5149457907}, {18.507917, 6.080104, 1.5114551322}};
+    Lamp lamp({0, 0}, 0);
+    std::vector<Mirror> mirrors;
+    Validation::load_solution(solution, lamp, mirrors);
+    differences += checkMoves(temple, lamp, mirrors, 0.02, 0.005, 0.9, 5000, gen, "good layout");
+
+    // Random repaired layout
+    std::vector<double> x = space.randomPoint(gen);
+    Repair::repair(temple, space, x, lamp, mirrors);
+    differences += checkMoves(temple, lamp, mirrors, 0.3, 0.1, 0.6, 5000, gen, "random layout");
+
+    // Enough mirrors for the BVH; overlapping mirrors are fine for the tracer
+    std::uniform_real_distribution<double> coordinate(1.0, 19.0);
+    std::uniform_real_distribution<double> angle(0.0, 2 * M_PI);
+    while (mirrors.size() < Validation::bvhMirrorThreshold + 8)
+    {
+        mirrors.push_back(Mirror({coordinate(gen), coordinate(gen)}, angle(gen)));
+    }
+    differences += checkMoves(temple, lamp, mirrors, 0.3, 0.1, 0.6, 3000, gen, "many mirrors");
+
+    return differences == 0 ? 0 : 1;
+}
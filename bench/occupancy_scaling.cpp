@@ -0,0 +1,114 @@
+// Synthetic scaling benchmark for the occupancy pyramid.
+//
+// Builds square temples of growing size (closed border, ~2% random blocks inside),
+// then measures the cost of one ray-temple intersection with the plain wall scan
+// and with the pyramid walk, and the cost of scoring a beam segment of fixed length.
+// Build and run with: make bench
+
+#include "../engine/ProblemSpec.h"
+#include "../engine/Temple.h"
+#include "../engine/Validation.h"
+#include "../engine/Scorer.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+
+static std::string syntheticTemple(int n, double density, std::mt19937& gen)
+{
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::string layout;
+    for (int j = 0; j < n; ++j)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            bool border = i == 0 || j == 0 || i == n - 1 || j == n - 1;
+            layout += (border || uniform(gen) < density) ? 'O' : '.';
+        }
+        layout += '\n';
+    }
+    return layout;
+}
+
+static double secondsSince(const std::chrono::steady_clock::time_point &start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+    std::mt19937 gen(2024);
+    const int sizes[] = {20, 50, 100, 200, 500, 1000};
+
+    std::printf("%6s %9s %8s %13s %13s %13s\n", "size", "walls", "build s", "scan us/ray", "pyramid us/ray", "score us/seg");
+    for (int n : sizes)
+    {
+        ProblemSpec spec;
+        spec.temple_string = syntheticTemple(n, 0.02, gen);
+
+        auto start = std::chrono::steady_clock::now();
+        Temple temple(spec);
+        double buildTime = secondsSince(start);
+
+        // Random rays from vacant points
+        std::uniform_real_distribution<double> coordinate(1.0, n - 1.0);
+        std::uniform_real_distribution<double> angle(0.0, 2 * M_PI);
+        std::vector<Ray> rays;
+        while (rays.size() < 2000)
+        {
+            Vector2 origin(coordinate(gen), coordinate(gen));
+            double a = angle(gen);
+            if (!temple.pointInBlock(origin))
+            {
+                rays.push_back(Ray(origin, {std::cos(a), std::sin(a)}));
+            }
+        }
+
+        // Plain scan over every wall (fewer rays on big temples, it is slow)
+        size_t scanRays = std::max<size_t>(20, rays.size() * 20 / n);
+        scanRays = std::min(scanRays, rays.size());
+        double checksum = 0;
+        start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < scanRays; ++r)
+        {
+            double tMin = std::numeric_limits<double>::infinity();
+            for (const auto &wall : temple.getWalls())
+            {
+                auto [caseType, t, u] = Validation::ray_segment_intersection(rays[r], wall);
+                if ((caseType == 2 || caseType == 3) && t < tMin && t > 1e-12)
+                {
+                    tMin = t;
+                }
+            }
+            checksum += tMin;
+        }
+        double scanTime = secondsSince(start) / scanRays;
+
+        start = std::chrono::steady_clock::now();
+        for (const Ray &ray : rays)
+        {
+            checksum += Validation::temple_ray_intersection_pyramid(temple, ray);
+        }
+        double pyramidTime = secondsSince(start) / rays.size();
+
+        // Scoring cost of a 10 unit beam segment at 20 pixels per unit
+        Scorer scorer(temple, 20);
+        start = std::chrono::steady_clock::now();
+        for (const Ray &ray : rays)
+        {
+            Path path;
+            path.points = {ray.origin, ray.origin + ray.direction * 10.0};
+            path.directions = {ray.direction};
+            checksum += scorer.evaluatePath(path);
+        }
+        double scoreTime = secondsSince(start) / rays.size();
+
+        std::printf("%6d %9zu %8.3f %13.2f %13.2f %13.2f\n", n, temple.getWalls().size(), buildTime,
+                    scanTime * 1e6, pyramidTime * 1e6, scoreTime * 1e6);
+        if (checksum == 0.123)
+        {
+            std::printf("\n"); // Keeps the measured work from being optimized away
+        }
+    }
+    return 0;
+}
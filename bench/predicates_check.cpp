@@ -0,0 +1,98 @@
+// Check of the filtered exact predicates against integer arithmetic.
+//
+// All inputs are doubles on a lattice of 2^-48 below 32 in magnitude, so every
+// coordinate is an integer times 2^-48, every product an integer times 2^-96
+// below 2^106 and the sums of up to six products fit in a 128-bit integer. The
+// inputs are made near-degenerate (q on the line p + t r, rounded to the
+// lattice and sometimes nudged by one step), which is where the naive double
+// formula gets signs wrong. Exits with 1 if a predicate disagrees with the
+// exact sign.
+// Build and run with: make check
+
+#include "../math/Predicates.h"
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+typedef __int128 Exact;
+
+static const int latticeBits = 48;
+
+static double onLattice(double value)
+{
+    return std::ldexp((double)std::llround(std::ldexp(value, latticeBits)), -latticeBits);
+}
+
+static Exact exact(double value)
+{
+    return (Exact)std::llround(std::ldexp(value, latticeBits));
+}
+
+static int sign(Exact value)
+{
+    return (value > 0) - (value < 0);
+}
+
+static int sign(double value)
+{
+    return (value > 0) - (value < 0);
+}
+
+static Exact cross(double ax, double ay, double bx, double by)
+{
+    return exact(ax) * exact(by) - exact(ay) * exact(bx);
+}
+
+int main()
+{
+    std::mt19937_64 gen(1);
+    std::uniform_real_distribution<double> coordinate(0.0, 10.0);
+    std::uniform_real_distribution<double> direction(-8.0, 8.0);
+    std::uniform_real_distribution<double> along(0.0, 1.5);
+    const int tests = 20000;
+
+    int wrong[3] = {0, 0, 0};
+    int naiveWrong[3] = {0, 0, 0};
+    for (int k = 0; k < tests; ++k)
+    {
+        Vector2 p(onLattice(coordinate(gen)), onLattice(coordinate(gen)));
+        Vector2 r(onLattice(direction(gen)), onLattice(direction(gen)));
+        Vector2 q = p + r * along(gen);
+        q = Vector2(onLattice(q.x), onLattice(q.y));
+        if (k % 3 == 1)
+        {
+            q.x += std::ldexp(k % 2 ? 1.0 : -1.0, -latticeBits);
+        }
+        // s nearly parallel to r and w nearly such that (q - p) x w = r x s
+        Vector2 s(onLattice(r.x * 0.5), onLattice(r.y * 0.5));
+        if (k % 5 == 2)
+        {
+            s.y += std::ldexp(1.0, -latticeBits);
+        }
+        Vector2 w = s;
+
+        // sign(r x s)
+        int expected = sign(cross(r.x, r.y, s.x, s.y));
+        wrong[0] += Predicates::crossSign(r, s) != expected;
+        naiveWrong[0] += sign(r.cross(s)) != expected;
+
+        // sign((q - p) x r)
+        expected = sign(cross(q.x, q.y, r.x, r.y) - cross(p.x, p.y, r.x, r.y));
+        wrong[1] += Predicates::diffCrossSign(q, p, r) != expected;
+        naiveWrong[1] += sign((q - p).cross(r)) != expected;
+
+        // sign(r x s - (q - p) x w)
+        expected = sign(cross(r.x, r.y, s.x, s.y) - cross(q.x, q.y, w.x, w.y) + cross(p.x, p.y, w.x, w.y));
+        wrong[2] += Predicates::crossMinusDiffCrossSign(r, s, q, p, w) != expected;
+        naiveWrong[2] += sign(r.cross(s) - (q - p).cross(w)) != expected;
+    }
+
+    const char *names[] = {"crossSign", "diffCrossSign", "crossMinusDiffCrossSign"};
+    bool ok = true;
+    for (int i = 0; i < 3; ++i)
+    {
+        std::printf("%-24s %d tests: %d wrong signs (naive formula: %d)\n", names[i], tests, wrong[i], naiveWrong[i]);
+        ok = ok && wrong[i] == 0;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,89 @@
+// Check of Symmetry's canonical keys.
+//
+// Random solutions are mapped by every transform of the temple's group; each
+// image must get the key of the original, and canonicalizing it must give a
+// solution with that same key. Runs on the CMC24 temple (reflections and the
+// half turn) and on a square temple with the full group of the square (also the
+// quarter turns and diagonal flips), for even and odd angle cell counts. Exits
+// with 1 on any mismatch.
+// Build and run with: make check
+
+#include "../engine/ProblemSpec.h"
+#include "../engine/Temple.h"
+#include "../engine/Symmetry.h"
+#include <cstdio>
+#include <random>
+#include <string>
+
+// Border, four blocks near the corners and four in the middle of a 20 x 20 grid
+static std::string squareTemple()
+{
+    std::string layout;
+    for (int j = 0; j < 20; ++j)
+    {
+        for (int i = 0; i < 20; ++i)
+        {
+            bool border = i == 0 || j == 0 || i == 19 || j == 19;
+            bool corner = (i == 5 || i == 14) && (j == 5 || j == 14);
+            bool middle = (i == 9 || i == 10) && (j == 9 || j == 10);
+            layout += border || corner || middle ? 'O' : '.';
+        }
+        layout += '\n';
+    }
+    return layout;
+}
+
+// Images of random solutions whose key differs from the original's
+static int checkKeys(const Temple &temple, int angles, int solutions, std::mt19937_64 &gen, const char *name)
+{
+    Symmetry symmetry(temple);
+    auto [sizeX, sizeY] = temple.getSize();
+    std::uniform_real_distribution<double> x(0.0, sizeX), y(0.0, sizeY), angle(0.0, 2 * M_PI);
+    const double mirrorLength = temple.getSpec().mirror_length;
+    const double position = 1e-4;
+
+    int mismatches = 0;
+    for (int k = 0; k < solutions; ++k)
+    {
+        Lamp lamp({x(gen), y(gen)}, angle(gen));
+        std::vector<Mirror> mirrors;
+        for (int m = 0; m < 8; ++m)
+        {
+            mirrors.push_back(Mirror({x(gen), y(gen)}, angle(gen), mirrorLength));
+        }
+        std::vector<long long> key = symmetry.canonicalKey(lamp, mirrors, position, angles);
+
+        for (const Symmetry::Transform &transform : symmetry.getGroup())
+        {
+            Lamp imageLamp = symmetry.apply(transform, lamp);
+            std::vector<Mirror> imageMirrors;
+            for (const Mirror &mirror : mirrors)
+            {
+                imageMirrors.push_back(symmetry.apply(transform, mirror));
+            }
+            mismatches += symmetry.canonicalKey(imageLamp, imageMirrors, position, angles) != key;
+            symmetry.canonicalize(imageLamp, imageMirrors, position, angles);
+            mismatches += symmetry.canonicalKey(imageLamp, imageMirrors, position, angles) != key;
+        }
+    }
+    std::printf("%-8s group of %d, angles %6d: %d mismatches in %d solutions\n", name, symmetry.order(), angles,
+                mismatches, solutions);
+    return mismatches;
+}
+
+int main()
+{
+    std::mt19937_64 gen(7);
+    Temple cmc24;
+    ProblemSpec spec;
+    spec.temple_string = squareTemple();
+    Temple square(spec);
+
+    int mismatches = 0;
+    for (int angles : {180, 179, 100000, 99999})
+    {
+        mismatches += checkKeys(cmc24, angles, 2000, gen, "CMC24");
+        mismatches += checkKeys(square, angles, 2000, gen, "square");
+    }
+    return mismatches == 0 ? 0 : 1;
+}
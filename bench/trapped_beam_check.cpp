@@ -0,0 +1,68 @@
+// Regression check for beams trapped between mirrors.
+//
+// From the lamp at (1.5, 8.5) aiming along +x, a vertical mirror 4 units ahead
+// sends the beam straight back onto a vertical mirror centred on the lamp, and
+// the beam bounces between the two forever. The trace must stop at the segment
+// cap, and branch-and-bound and beam search, whose grids contain exactly these
+// poses, must finish. Exits with 1 if the trace isn't capped or branch-and-bound
+// runs far past its budget.
+// Build and run with: make check
+
+#include "../engine/Temple.h"
+#include "../engine/Validation.h"
+#include "../engine/ScoringContext.h"
+#include "../engine/ThreadPool.h"
+#include "../engine/BeamSearch.h"
+#include "../engine/BranchAndBound.h"
+#include <chrono>
+#include <cstdio>
+
+static double secondsSince(const std::chrono::steady_clock::time_point &start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Vertical mirror centred on the point
+static Mirror verticalMirror(const Temple &temple, const Vector2 &centre)
+{
+    double length = temple.getSpec().mirror_length;
+    return Mirror(centre - Vector2(0, length / 2), M_PI / 2, length);
+}
+
+int main()
+{
+    Temple temple;
+    Lamp lamp({1.5, 8.5}, 0);
+    bool ok = true;
+
+    std::vector<Mirror> trap = {verticalMirror(temple, {5.5, 8.5}), verticalMirror(temple, {1.5, 8.5})};
+    Path path = Validation::raytrace(temple, lamp, trap);
+    size_t cap = Validation::max_trace_segments(temple, trap.size());
+    std::printf("Trapped beam: %zu segments (cap %zu)\n", path.directions.size(), cap);
+    ok = ok && path.directions.size() == cap;
+
+    ThreadPool pool(1);
+    std::vector<ScoringContext> contexts{ScoringContext(temple, 10)};
+
+    BranchAndBoundOptions options;
+    options.seconds = 5;
+    options.report = false;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Mirror> mirrors;
+    double score = BranchAndBound(temple, pool, contexts, options).run(lamp, mirrors, 2);
+    double elapsed = secondsSince(start);
+    std::printf("Branch-and-bound, 2 mirrors: %.4f in %.1f s (budget %.0f s)\n", score, elapsed, options.seconds);
+    ok = ok && elapsed < options.seconds + 5;
+
+    // Beam search has no budget; its grid holds the same poses, so it must simply finish
+    BeamOptions beamOptions;
+    beamOptions.beamWidth = 4;
+    beamOptions.positionStep = 1.0;
+    beamOptions.angleCount = 36;
+    beamOptions.report = false;
+    start = std::chrono::steady_clock::now();
+    BeamState state = BeamSearch(temple, pool, contexts, beamOptions).run(lamp, 8);
+    std::printf("Beam search, width 4, 8 mirrors: %.4f in %.1f s\n", state.score, secondsSince(start));
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,169 @@
+#ifndef ANNEALING_H
+#define ANNEALING_H
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include "../math/Vector2.h"
+#include "Temple.h"
+#include "Lamp.h"
+#include "Mirror.h"
+#include "SolutionSpace.h"
+#include "LocalMoves.h"
+
+struct AnnealingOptions
+{
+    double seconds = 60;               // Wall-clock budget
+    long long maxIterations = -1;      // Also stop after this many moves (< 0 for no limit)
+    double initialTemperature = 0;     // 0 calibrates it from random moves
+    double finalTemperature = 1e-3;    // Temperature at the end of the budget
+    long long reheatAfter = 20000;     // Moves without a new best before reheating
+    double reheatFactor = 0.5;         // Each reheat starts at this fraction of the previous start temperature
+    double targetAcceptance = 0.4;     // Per-dimension acceptance rate the step sizes aim for
+    int adaptEvery = 100;              // Moves of one dimension between two step size adjustments
+    long long reportEvery = 10000;     // Progress line every this many moves (0 for none)
+    unsigned long long seed = 1;
+};
+
+// Simulated annealing over the full solution (lamp + mirrors). A move changes one
+// coordinate of one element, is repaired if it makes the solution infeasible and
+// is scored incrementally: only the part of the path after the first segment the
+// element touches is traced and scored again, and a rejected move is undone.
+//
+// Every coordinate has its own step size, adapted towards the target acceptance
+// rate (see LocalMoves). The temperature decays exponentially over the budget; when the best
+// score stalls, the search jumps back to the best solution and reheats.
+class SimulatedAnnealing
+{
+public:
+    SimulatedAnnealing(const Temple &temple, int pixelsPerUnit, const AnnealingOptions &options = AnnealingOptions())
+        : moves(temple, pixelsPerUnit, options.targetAcceptance, options.adaptEvery), options(options), rng(options.seed)
+    {
+    }
+
+    // Anneal from the given (feasible) solution. Returns the best score and leaves the
+    // best solution in lamp and mirrors.
+    double run(Lamp &lamp, std::vector<Mirror> &mirrors)
+    {
+        const int elements = mirrors.size() + 1;
+        moves.resetSteps(elements);
+        double current = moves.reset(lamp, mirrors);
+        double best = current;
+        Lamp bestLamp = lamp;
+        std::vector<Mirror> bestMirrors = mirrors;
+
+        double startTemperature = options.initialTemperature > 0 ? options.initialTemperature : calibrateTemperature();
+        double phaseTemperature = startTemperature;
+        double phaseStart = 0;
+        double temperature = startTemperature;
+
+        start = std::chrono::steady_clock::now();
+        long long sinceBest = 0;
+        long long accepted = 0;
+        int reheats = 0;
+        long long iteration = 0;
+        for (;; ++iteration)
+        {
+            double progress = elapsedFraction(iteration);
+            if (progress >= 1)
+            {
+                break;
+            }
+
+            // Exponential decay from the phase start temperature to the final one at the end of the budget
+            double phaseProgress = (progress - phaseStart) / (1 - phaseStart);
+            temperature = phaseTemperature * std::pow(options.finalTemperature / phaseTemperature, phaseProgress);
+
+            int d = std::uniform_int_distribution<int>(0, 3 * elements - 1)(rng);
+            double score;
+            if (!moves.propose(d, rng, score))
+            {
+                moves.failed(d);
+                continue;
+            }
+
+            double delta = score - current;
+            bool accept = delta >= 0 || std::uniform_real_distribution<double>(0, 1)(rng) < std::exp(delta / temperature);
+            if (accept)
+            {
+                ++accepted;
+                current = score;
+            }
+            moves.decide(d, accept);
+
+            if (current > best)
+            {
+                best = current;
+                bestLamp = moves.getLamp();
+                bestMirrors = moves.getMirrors();
+                sinceBest = 0;
+            }
+            else if (++sinceBest >= options.reheatAfter)
+            {
+                // Reheat: continue from the best solution with a fresh, cooler schedule
+                phaseTemperature = std::max(phaseTemperature * options.reheatFactor, options.finalTemperature);
+                phaseStart = progress;
+                current = moves.reset(bestLamp, bestMirrors);
+                sinceBest = 0;
+                ++reheats;
+            }
+
+            if (options.reportEvery > 0 && (iteration + 1) % options.reportEvery == 0)
+            {
+                printf("Iteration %lld: T = %.5f, current = %.4f, best = %.4f, acceptance = %.3f, reheats = %d\n",
+                       iteration + 1, temperature, current, best, (double)accepted / (iteration + 1), reheats);
+            }
+        }
+
+        printf("Annealing finished after %lld moves: best = %.4f, reheats = %d\n", iteration, best, reheats);
+        lamp = bestLamp;
+        mirrors = bestMirrors;
+        return best;
+    }
+
+private:
+    LocalMoves moves;
+    AnnealingOptions options;
+    std::mt19937_64 rng;
+    std::chrono::steady_clock::time_point start;
+
+    double elapsedFraction(long long iteration) const
+    {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double fraction = seconds / options.seconds;
+        if (options.maxIterations >= 0)
+        {
+            fraction = std::max(fraction, (double)iteration / options.maxIterations);
+        }
+        return fraction;
+    }
+
+    // Start temperature at which an average worsening move is accepted half of the time
+    double calibrateTemperature()
+    {
+        double worsening = 0;
+        int count = 0;
+        for (int k = 0; k < 200; ++k)
+        {
+            int d = std::uniform_int_distribution<int>(0, moves.dimensions() - 1)(rng);
+            double before = moves.score();
+            double score;
+            if (!moves.propose(d, rng, score))
+            {
+                continue;
+            }
+            if (score < before)
+            {
+                worsening += before - score;
+                ++count;
+            }
+            moves.undo(d);
+        }
+        return count > 0 ? worsening / count / std::log(2.0) : 1.0;
+    }
+};
+
+#endif // ANNEALING_H
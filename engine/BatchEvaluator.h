@@ -0,0 +1,60 @@
+#ifndef BATCH_EVALUATOR_H
+#define BATCH_EVALUATOR_H
+
+#include <vector>
+#include "Temple.h"
+#include "SolutionSpace.h"
+#include "ScoringContext.h"
+#include "ThreadPool.h"
+#include "Repair.h"
+
+// The scoring interface shared by the population-based optimizers: an encoded
+// solution (see SolutionSpace) is repaired in place and scored, and a whole
+// population is scored in parallel with one scoring context per pool worker.
+// A candidate that can't be repaired scores 0.
+class BatchEvaluator
+{
+public:
+    BatchEvaluator(const Temple &temple, ThreadPool &pool, std::vector<ScoringContext> &contexts)
+        : temple(temple), space(temple), pool(pool), contexts(contexts)
+    {
+    }
+
+    const SolutionSpace &getSpace() const
+    {
+        return space;
+    }
+
+    // Repair x in place and score it in the given context
+    double evaluate(std::vector<double> &x, ScoringContext &context) const
+    {
+        if (!Repair::repair(temple, space, x, context.lamp, context.mirrors))
+        {
+            return 0;
+        }
+        return context.evaluate();
+    }
+
+    // Repair and score every point in parallel; scores[i] belongs to points[i]
+    void evaluate(std::vector<std::vector<double>> &points, std::vector<double> &scores)
+    {
+        scores.resize(points.size());
+        pool.parallelFor(points.size(), [&](int worker, size_t i)
+                         { scores[i] = evaluate(points[i], contexts[worker]); });
+        evaluations += points.size();
+    }
+
+    long long getEvaluations() const
+    {
+        return evaluations;
+    }
+
+private:
+    const Temple &temple;
+    SolutionSpace space;
+    ThreadPool &pool;
+    std::vector<ScoringContext> &contexts;
+    long long evaluations = 0;
+};
+
+#endif // BATCH_EVALUATOR_H
@@ -0,0 +1,230 @@
+#ifndef BEAM_SEARCH_H
+#define BEAM_SEARCH_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <unordered_set>
+#include <vector>
+#include "../math/Vector2.h"
+#include "Temple.h"
+#include "Lamp.h"
+#include "Mirror.h"
+#include "Validation.h"
+#include "ScoringContext.h"
+#include "ThreadPool.h"
+#include "Repair.h"
+#include "Symmetry.h"
+
+struct BeamOptions
+{
+    int beamWidth = 8;            // Partial solutions kept at every depth
+    double positionStep = 0.2;    // Spacing of mirror centres along the beam's last segment
+    int angleCount = 360;         // Mirror angles tried in [0, pi); a mirror centred on the beam is the same at angle + pi
+    double hashPosition = 0.1;    // Grid of the canonical key: two states whose elements fall into the same
+    int hashAngles = 180;         // cells (position, angle in [0, pi) for mirrors) count as duplicates
+    bool report = true;
+};
+
+// One node of the search: the lamp and the first mirrors, with the coverage of their path
+struct BeamState
+{
+    Lamp lamp;
+    std::vector<Mirror> mirrors;
+    double score = 0;
+
+    BeamState(const Lamp &lamp, const std::vector<Mirror> &mirrors, double score)
+        : lamp(lamp), mirrors(mirrors), score(score)
+    {
+    }
+};
+
+// Beam search over sequential mirror placement. Where the greedy solver commits to
+// the single best pose for every mirror in turn, this keeps the best `beamWidth`
+// partial solutions at each depth. Every state is expanded by placing one more
+// mirror centred on the last segment of its beam, at every position step and
+// angle, rejecting poses that break the temple or mirror constraints. The
+// (state, position) tasks are scored in parallel, one scoring context per
+// worker; merging is serial in task order, so results don't depend on the
+// thread count. States that are equal up to the hash grid, the order of their
+// mirrors and the symmetries of the temple are kept once.
+class BeamSearch
+{
+public:
+    BeamSearch(const Temple &temple, ThreadPool &pool, std::vector<ScoringContext> &contexts,
+               const BeamOptions &options = BeamOptions())
+        : temple(temple), pool(pool), contexts(contexts), options(options), symmetry(temple)
+    {
+    }
+
+    // Place mirrorCount mirrors after the given lamp. Returns the best complete state
+    // (the best deepest one if no state could be completed).
+    BeamState run(const Lamp &lamp, int mirrorCount)
+    {
+        ScoringContext &context = contexts.front();
+        context.lamp = lamp;
+        context.mirrors.clear();
+        std::vector<BeamState> beam{BeamState(lamp, {}, context.evaluate())};
+
+        for (int depth = 0; depth < mirrorCount; ++depth)
+        {
+            std::vector<BeamState> next = expand(beam);
+            if (next.empty())
+            {
+                if (options.report)
+                {
+                    printf("Beam search: no feasible pose for mirror %d\n", depth + 1);
+                }
+                break;
+            }
+            beam.swap(next);
+            if (options.report)
+            {
+                printf("Depth %d: %zu states, best = %.4f, worst = %.4f\n",
+                       depth + 1, beam.size(), beam.front().score, beam.back().score);
+            }
+        }
+        return beam.front();
+    }
+
+    long long getEvaluations() const
+    {
+        return evaluations;
+    }
+
+private:
+    const Temple &temple;
+    ThreadPool &pool;
+    std::vector<ScoringContext> &contexts;
+    BeamOptions options;
+    Symmetry symmetry;
+    long long evaluations = 0;
+
+    struct Candidate
+    {
+        double score;
+        size_t parent;
+        Vector2 position; // v1 of the new mirror
+        double angle;
+    };
+
+    // Mirror positions tried on one segment of one state
+    struct Task
+    {
+        size_t state;
+        Vector2 centre;
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const std::vector<long long> &key) const
+        {
+            size_t hash = 1469598103934665603ULL;
+            for (long long value : key)
+            {
+                hash ^= (size_t)value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+            }
+            return hash;
+        }
+    };
+
+    std::vector<BeamState> expand(const std::vector<BeamState> &beam)
+    {
+        // Positions along the last segment of every state's beam
+        std::vector<Task> tasks;
+        for (size_t s = 0; s < beam.size(); ++s)
+        {
+            // A beam trapped between mirrors stops at the segment cap instead of leaving
+            // through a last segment; it has nowhere to place the next mirror
+            Path path = Validation::raytrace(temple, beam[s].lamp, beam[s].mirrors);
+            if (path.directions.empty() ||
+                path.directions.size() >= Validation::max_trace_segments(temple, beam[s].mirrors.size()))
+            {
+                continue;
+            }
+            const Vector2 &start = path.points[path.points.size() - 2];
+            const Vector2 &direction = path.directions.back();
+            double length = (path.points.back() - start).magnitude();
+            for (double t = options.positionStep; t < length; t += options.positionStep)
+            {
+                tasks.push_back({s, start + direction * t});
+            }
+        }
+
+        // Best candidates of every task. Neighbouring angles of one task often hash to the
+        // same state, so a few times the beam width is kept to leave room for duplicates.
+        const size_t keep = 4 * options.beamWidth;
+        const double mirrorLength = temple.getSpec().mirror_length;
+        std::vector<std::vector<Candidate>> results(tasks.size());
+        std::vector<int> scored(tasks.size(), 0);
+        pool.parallelFor(tasks.size(), [&](int worker, size_t i)
+                         {
+            ScoringContext &context = contexts[worker];
+            const BeamState &state = beam[tasks[i].state];
+            context.lamp = state.lamp;
+            context.mirrors = state.mirrors;
+            context.mirrors.push_back(Mirror({0, 0}, 0, mirrorLength));
+            Mirror &mirror = context.mirrors.back();
+            std::vector<Candidate> &best = results[i];
+            for (int a = 0; a < options.angleCount; ++a)
+            {
+                double angle = M_PI * a / options.angleCount;
+                Vector2 direction(std::cos(angle), std::sin(angle));
+                mirror.updateMirror(tasks[i].centre - direction * (mirrorLength / 2), angle);
+                if (!Repair::mirrorFeasible(temple, mirror) || Repair::crossesAny(mirror, state.mirrors, state.mirrors.size()))
+                {
+                    continue;
+                }
+                insert(best, {context.evaluate(), tasks[i].state, mirror.v1, angle}, keep);
+                ++scored[i];
+            } });
+        for (int count : scored)
+        {
+            evaluations += count;
+        }
+
+        std::vector<Candidate> candidates;
+        for (const std::vector<Candidate> &result : results)
+        {
+            candidates.insert(candidates.end(), result.begin(), result.end());
+        }
+        std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b)
+                         { return a.score > b.score; });
+
+        std::vector<BeamState> next;
+        std::unordered_set<std::vector<long long>, KeyHash> seen;
+        for (const Candidate &candidate : candidates)
+        {
+            if ((int)next.size() >= options.beamWidth)
+            {
+                break;
+            }
+            BeamState state = beam[candidate.parent];
+            state.mirrors.push_back(Mirror(candidate.position, candidate.angle, mirrorLength));
+            state.score = candidate.score;
+            if (seen.insert(symmetry.canonicalKey(state.lamp, state.mirrors, options.hashPosition, options.hashAngles)).second)
+            {
+                next.push_back(std::move(state));
+            }
+        }
+        return next;
+    }
+
+    // Keep the `keep` best candidates, best first
+    static void insert(std::vector<Candidate> &best, const Candidate &candidate, size_t keep)
+    {
+        if (best.size() >= keep && candidate.score <= best.back().score)
+        {
+            return;
+        }
+        auto at = std::upper_bound(best.begin(), best.end(), candidate, [](const Candidate &a, const Candidate &b)
+                                   { return a.score > b.score; });
+        best.insert(at, candidate);
+        if (best.size() > keep)
+        {
+            best.pop_back();
+        }
+    }
+};
+
+#endif // BEAM_SEARCH_H
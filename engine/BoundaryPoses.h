@@ -0,0 +1,270 @@
+#ifndef BOUNDARY_POSES_H
+#define BOUNDARY_POSES_H
+
+#include "../math/Vector2.h"
+#include "Temple.h"
+#include "Lamp.h"
+#include "Mirror.h"
+#include "Validation.h"
+#include "SolutionSpace.h"
+#include "Repair.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+// Poses on the constraint boundary. The best layouts put the lamp and mirrors
+// right against the blocks (x = 1.0001 and the like), where random sampling
+// almost never lands. This generator enumerates and samples those poses
+// directly.
+//
+// A face is a maximal run of block sides facing the same vacant side; a point
+// on it is described by its fraction s along the run and sits `offset` off the
+// face, the tightest distance check_solution accepts. The lamp is placed on a
+// face point, aiming into the free half-plane. A mirror touches a face with one
+// end and points away from it at angle phi in (0, pi) from the face direction.
+// It may also touch a block corner from any vacant quadrant. Mirror poses are
+// kept only if they pass the temple tests of check_solution.
+class BoundaryPoses {
+public:
+    struct Face {
+        Vector2 start;      // On the face line, `offset` already applied
+        Vector2 direction;  // Unit vector along the face
+        Vector2 normal;     // Unit vector into the vacant side
+        double length;
+    };
+
+    explicit BoundaryPoses(const Temple& temple, double offset = 1e-4)
+        : temple(temple), mirrorLength(temple.getSpec().mirror_length), offset(offset) {
+        buildFaces();
+        buildCorners();
+    }
+
+    const std::vector<Face>& getFaces() const {
+        return faces;
+    }
+
+    // Points off the block corners, one per vacant quadrant
+    const std::vector<Vector2>& getCorners() const {
+        return corners;
+    }
+
+    Vector2 facePoint(int face, double s) const {
+        return faces[face].start + faces[face].direction * (s * faces[face].length);
+    }
+
+    // Direction angle phi in (0, pi) from the face direction, measured towards the vacant side
+    double faceAngle(int face, double phi) const {
+        const Face& f = faces[face];
+        double base = std::atan2(f.direction.y, f.direction.x);
+        double side = f.direction.cross(f.normal) > 0 ? 1 : -1;
+        return SolutionSpace::wrapAngle(base + side * phi);
+    }
+
+    bool lampOnFace(int face, double s, double phi, Lamp& lamp) const {
+        lamp.updateLamp(facePoint(face, s), faceAngle(face, phi));
+        return Repair::lampFeasible(temple, lamp.v);
+    }
+
+    bool mirrorOnFace(int face, double s, double phi, Mirror& mirror) const {
+        mirror.updateMirror(facePoint(face, s), faceAngle(face, phi), mirrorLength);
+        return Repair::mirrorFeasible(temple, mirror);
+    }
+
+    bool mirrorAtCorner(int corner, double angle, Mirror& mirror) const {
+        mirror.updateMirror(corners[corner], SolutionSpace::wrapAngle(angle), mirrorLength);
+        return Repair::mirrorFeasible(temple, mirror);
+    }
+
+    // Every feasible mirror pose on a grid: face points every `step` world units and
+    // angleCount angles over (0, pi) on each, angleCount * 2 angles at each corner
+    std::vector<Mirror> enumerateMirrors(double step, int angleCount) const {
+        std::vector<Mirror> poses;
+        Mirror mirror({0, 0}, 0, mirrorLength);
+        for (int f = 0; f < (int)faces.size(); ++f) {
+            for (double along = 0; along <= faces[f].length; along += step) {
+                for (int a = 1; a <= angleCount; ++a) {
+                    if (mirrorOnFace(f, along / faces[f].length, M_PI * a / (angleCount + 1), mirror)) {
+                        poses.push_back(mirror);
+                    }
+                }
+            }
+        }
+        for (int c = 0; c < (int)corners.size(); ++c) {
+            for (int a = 0; a < 2 * angleCount; ++a) {
+                if (mirrorAtCorner(c, M_PI * a / angleCount, mirror)) {
+                    poses.push_back(mirror);
+                }
+            }
+        }
+        return poses;
+    }
+
+    // Every feasible lamp pose on a grid of face points and angles into the free side
+    std::vector<Lamp> enumerateLamps(double step, int angleCount) const {
+        std::vector<Lamp> poses;
+        Lamp lamp({0, 0}, 0);
+        for (int f = 0; f < (int)faces.size(); ++f) {
+            for (double along = 0; along <= faces[f].length; along += step) {
+                for (int a = 1; a <= angleCount; ++a) {
+                    if (lampOnFace(f, along / faces[f].length, M_PI * a / (angleCount + 1), lamp)) {
+                        poses.push_back(lamp);
+                    }
+                }
+            }
+        }
+        return poses;
+    }
+
+    // Random feasible boundary poses; false if none was found in `attempts` tries
+    bool randomLamp(std::mt19937_64& rng, Lamp& lamp, int attempts = 100) const {
+        for (int k = 0; k < attempts && !faces.empty(); ++k) {
+            int face = randomFace(rng);
+            if (lampOnFace(face, uniform(rng), M_PI * uniform(rng), lamp)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool randomMirror(std::mt19937_64& rng, Mirror& mirror, double cornerProbability = 0.2, int attempts = 100) const {
+        for (int k = 0; k < attempts && !faces.empty(); ++k) {
+            bool ok;
+            if (!corners.empty() && uniform(rng) < cornerProbability) {
+                int corner = std::uniform_int_distribution<int>(0, corners.size() - 1)(rng);
+                ok = mirrorAtCorner(corner, 2 * M_PI * uniform(rng), mirror);
+            } else {
+                ok = mirrorOnFace(randomFace(rng), uniform(rng), M_PI * uniform(rng), mirror);
+            }
+            if (ok) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // A random encoded solution (see SolutionSpace) in which every element is put on
+    // the boundary with the given probability and drawn uniformly otherwise. Nothing is
+    // checked between elements; optimizers repair the point as usual.
+    std::vector<double> randomPoint(std::mt19937_64& rng, const SolutionSpace& space, double probability = 0.5) const {
+        std::vector<double> x = space.randomPoint(rng);
+        for (int element = 0; element <= space.mirrorCount(); ++element) {
+            if (uniform(rng) >= probability) {
+                continue;
+            }
+            Vector2 position;
+            double angle;
+            if (element == 0) {
+                Lamp lamp({0, 0}, 0);
+                if (!randomLamp(rng, lamp)) {
+                    continue;
+                }
+                position = lamp.v;
+                angle = lamp.angle;
+            } else {
+                Mirror mirror({0, 0}, 0, mirrorLength);
+                if (!randomMirror(rng, mirror)) {
+                    continue;
+                }
+                position = mirror.v1;
+                angle = mirror.angle;
+            }
+            x[3 * element] = position.x;
+            x[3 * element + 1] = position.y;
+            x[3 * element + 2] = angle;
+        }
+        return x;
+    }
+
+private:
+    const Temple& temple;
+    double mirrorLength;
+    double offset;
+    std::vector<Face> faces;
+    std::vector<Vector2> corners;
+    std::vector<double> cumulativeLength; // For picking faces by length
+
+    static double uniform(std::mt19937_64& rng) {
+        return std::uniform_real_distribution<double>(0, 1)(rng);
+    }
+
+    int randomFace(std::mt19937_64& rng) const {
+        double target = uniform(rng) * cumulativeLength.back();
+        int face = std::upper_bound(cumulativeLength.begin(), cumulativeLength.end(), target) - cumulativeLength.begin();
+        return std::min(face, (int)faces.size() - 1);
+    }
+
+    bool vacant(int i, int j) const {
+        auto shape = temple.getShape();
+        return i >= 0 && j >= 0 && i < shape.first && j < shape.second && !temple.isBlocked(i, j);
+    }
+
+    // Runs of cell sides between a block and a vacant cell of the temple, split by side
+    void buildFaces() {
+        auto [width, height] = temple.getShape();
+        double cell = temple.getBlockSize();
+
+        auto addRuns = [&](int lines, int cells, bool horizontal) {
+            for (int line = 0; line <= lines; ++line) {
+                for (int side = -1; side <= 1; side += 2) {
+                    // The vacant cell is on side `side` of the line, the block on the other
+                    int start = -1;
+                    for (int k = 0; k <= cells; ++k) {
+                        bool exposed = false;
+                        if (k < cells) {
+                            int free = side > 0 ? line : line - 1;
+                            int blocked = side > 0 ? line - 1 : line;
+                            exposed = horizontal ? vacant(k, free) && temple.isBlocked(k, blocked)
+                                                 : vacant(free, k) && temple.isBlocked(blocked, k);
+                        }
+                        if (exposed && start < 0) {
+                            start = k;
+                        } else if (!exposed && start >= 0) {
+                            Vector2 normal = horizontal ? Vector2(0, side) : Vector2(side, 0);
+                            Vector2 direction = horizontal ? Vector2(1, 0) : Vector2(0, 1);
+                            Vector2 origin = horizontal ? Vector2(start * cell, line * cell) : Vector2(line * cell, start * cell);
+                            // Pull the ends in by the offset too, so face points never touch a neighbouring block
+                            faces.push_back({origin + normal * offset + direction * offset, direction, normal,
+                                             (k - start) * cell - 2 * offset});
+                            start = -1;
+                        }
+                    }
+                }
+            }
+        };
+        addRuns(height, width, true);
+        addRuns(width, height, false);
+
+        double total = 0;
+        for (const Face& face : faces) {
+            total += face.length;
+            cumulativeLength.push_back(total);
+        }
+    }
+
+    // Every grid point touching a block, offset diagonally into each vacant quadrant around it
+    void buildCorners() {
+        auto [width, height] = temple.getShape();
+        double cell = temple.getBlockSize();
+        for (int j = 0; j <= height; ++j) {
+            for (int i = 0; i <= width; ++i) {
+                bool touchesBlock = temple.isBlocked(i, j) || temple.isBlocked(i - 1, j) ||
+                                    temple.isBlocked(i, j - 1) || temple.isBlocked(i - 1, j - 1);
+                if (!touchesBlock) {
+                    continue;
+                }
+                for (int dj = 0; dj <= 1; ++dj) {
+                    for (int di = 0; di <= 1; ++di) {
+                        int ci = i - 1 + di, cj = j - 1 + dj;
+                        if (vacant(ci, cj)) {
+                            Vector2 toward(di ? 1 : -1, dj ? 1 : -1);
+                            corners.push_back(Vector2(i * cell, j * cell) + toward * offset);
+                        }
+                    }
+                }
+            }
+        }
+    }
+};
+
+#endif // BOUNDARY_POSES_H
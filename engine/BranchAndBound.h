@@ -0,0 +1,285 @@
+#ifndef BRANCH_AND_BOUND_H
+#define BRANCH_AND_BOUND_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "../math/Vector2.h"
+#include "Temple.h"
+#include "Lamp.h"
+#include "Mirror.h"
+#include "Validation.h"
+#include "ScoringContext.h"
+#include "ThreadPool.h"
+#include "Repair.h"
+
+struct BranchAndBoundOptions
+{
+    double positionStep = 1.0;     // Discretization: mirror centres along the beam's last segment...
+    int angleCount = 36;           // ...times angles in [0, pi), as in BeamSearch
+    double seconds = 60;           // Budget; the result is only proved optimal if the search finishes
+    long long maxNodes = -1;       // Also stop after this many nodes (< 0 for no limit)
+    double incumbent = 0;          // Score of a known solution within the same discretization
+    bool report = true;
+};
+
+// Depth-first branch-and-bound over sequential mirror placement: every node is the
+// lamp with the first mirrors, and its children place the next mirror centred on
+// the last segment of its beam, on the same grid of positions and angles as
+// BeamSearch. Children are scored in parallel and visited best first.
+//
+// The search space is sequential paths: the beam meets the mirrors once each, in
+// placement order, so a child whose beam revisits a mirror or meets the new one
+// early is dropped. A node is pruned when an upper bound on the coverage of any
+// completion doesn't beat the incumbent. With k mirrors still to place, a
+// completion keeps at most the current path (its last leg only gets shorter) and
+// adds k legs. No leg covers more pixels than a capsule around the diagonal of
+// the vacant cells' bounding box, since a convex shape holds at most its area
+// plus half its perimeter plus one pixel centres (in pixel units). Nor can the
+// completion exceed the whole vacant area. Both bounds are admissible, so a
+// search that finishes within its budget proves that no sequential path on the
+// grid beats its result.
+class BranchAndBound
+{
+public:
+    BranchAndBound(const Temple &temple, ThreadPool &pool, std::vector<ScoringContext> &contexts,
+                   const BranchAndBoundOptions &options = BranchAndBoundOptions())
+        : temple(temple), pool(pool), contexts(contexts), options(options)
+    {
+        legBound = computeLegBound();
+    }
+
+    // Place mirrorCount mirrors after the lamp. Returns the best score found, with the
+    // solution in lamp and mirrors if it beat the incumbent (they are left alone otherwise).
+    double run(Lamp &lamp, std::vector<Mirror> &mirrors, int mirrorCount)
+    {
+        start = std::chrono::steady_clock::now();
+        nodes = 0;
+        pruned = 0;
+        stopped = false;
+        best = options.incumbent;
+        found = false;
+
+        std::vector<Mirror> placed;
+        ScoringContext &context = contexts.front();
+        context.lamp = lamp;
+        context.mirrors.clear();
+        search(lamp, placed, context.evaluate(), mirrorCount);
+
+        if (found)
+        {
+            lamp = bestLamp;
+            mirrors = bestMirrors;
+        }
+        if (options.report)
+        {
+            printf("Branch-and-bound: best = %.4f, %lld nodes, %lld pruned, %s\n", best, nodes, pruned,
+                   stopped ? "stopped on the budget" : "proved optimal for the discretization");
+        }
+        return best;
+    }
+
+    bool provedOptimal() const
+    {
+        return !stopped;
+    }
+
+    long long getNodes() const
+    {
+        return nodes;
+    }
+
+    // Most a single leg can add, as a percentage of the vacant area
+    double getLegBound() const
+    {
+        return legBound;
+    }
+
+private:
+    const Temple &temple;
+    ThreadPool &pool;
+    std::vector<ScoringContext> &contexts;
+    BranchAndBoundOptions options;
+    double legBound;
+    std::chrono::steady_clock::time_point start;
+    long long nodes = 0;
+    long long pruned = 0;
+    bool stopped = false;
+    double best = 0;
+    bool found = false;
+    Lamp bestLamp = Lamp({0, 0}, 0);
+    std::vector<Mirror> bestMirrors;
+
+    struct Child
+    {
+        Mirror mirror;
+        double score;
+    };
+
+    double bound(double score, int remaining) const
+    {
+        return std::min(100.0, score + remaining * legBound);
+    }
+
+    bool budgetSpent()
+    {
+        if (options.maxNodes >= 0 && nodes >= options.maxNodes)
+        {
+            return true;
+        }
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= options.seconds;
+    }
+
+    void search(const Lamp &lamp, std::vector<Mirror> &placed, double score, int remaining)
+    {
+        ++nodes;
+        if (remaining == 0)
+        {
+            if (score > best)
+            {
+                best = score;
+                bestLamp = lamp;
+                bestMirrors = placed;
+                found = true;
+                if (options.report)
+                {
+                    printf("New incumbent %.4f after %lld nodes\n", best, nodes);
+                }
+            }
+            return;
+        }
+        if (bound(score, remaining) <= best)
+        {
+            ++pruned;
+            return;
+        }
+        if (stopped || budgetSpent())
+        {
+            stopped = true;
+            return;
+        }
+
+        std::vector<Child> children = expand(lamp, placed);
+        std::stable_sort(children.begin(), children.end(), [](const Child &a, const Child &b)
+                         { return a.score > b.score; });
+        for (const Child &child : children)
+        {
+            if (bound(child.score, remaining - 1) <= best)
+            {
+                // Children are sorted, so none of the rest can do better
+                pruned += &children.back() - &child + 1;
+                break;
+            }
+            placed.push_back(child.mirror);
+            search(lamp, placed, child.score, remaining - 1);
+            placed.pop_back();
+            if (stopped)
+            {
+                return;
+            }
+        }
+    }
+
+    // Every feasible pose of the next mirror, scored in parallel
+    std::vector<Child> expand(const Lamp &lamp, const std::vector<Mirror> &placed)
+    {
+        const double mirrorLength = temple.getSpec().mirror_length;
+        std::vector<Child> children;
+        Path path = Validation::raytrace(temple, lamp, placed);
+        if (path.directions.empty())
+        {
+            return children;
+        }
+        const Vector2 &segmentStart = path.points[path.points.size() - 2];
+        const Vector2 &direction = path.directions.back();
+        double length = (path.points.back() - segmentStart).magnitude();
+        for (double t = options.positionStep; t < length; t += options.positionStep)
+        {
+            Vector2 centre = segmentStart + direction * t;
+            for (int a = 0; a < options.angleCount; ++a)
+            {
+                double angle = M_PI * a / options.angleCount;
+                Mirror mirror(centre - Vector2(std::cos(angle), std::sin(angle)) * (mirrorLength / 2), angle, mirrorLength);
+                if (Repair::mirrorFeasible(temple, mirror) && !Repair::crossesAny(mirror, placed, placed.size()))
+                {
+                    children.push_back({mirror, 0});
+                }
+            }
+        }
+
+        pool.parallelFor(children.size(), [&](int worker, size_t i)
+                         {
+            ScoringContext &context = contexts[worker];
+            context.lamp = lamp;
+            context.mirrors = placed;
+            context.mirrors.push_back(children[i].mirror);
+            children[i].score = sequential(context) ? context.scorer.evaluatePath(context.path) : -1; });
+        children.erase(std::remove_if(children.begin(), children.end(), [](const Child &child)
+                                      { return child.score < 0; }),
+                       children.end());
+        return children;
+    }
+
+    // Trace the context's solution into its path; true if the beam meets mirrors 0, 1, ...
+    // once each in that order and then ends on the temple
+    bool sequential(ScoringContext &context) const
+    {
+        TraceHits hits;
+        context.path.points.assign(1, context.lamp.v);
+        context.path.directions.clear();
+        Validation::trace_from(temple, context.mirrors, nullptr, Ray(context.lamp.v, context.lamp.direction),
+                               context.path, &hits);
+        // One segment per mirror plus the last; a trace stopped at the segment cap (a beam
+        // trapped between mirrors) has more
+        if (hits.mirrors.size() != context.mirrors.size() + 1)
+        {
+            return false;
+        }
+        for (size_t s = 0; s < hits.mirrors.size(); ++s)
+        {
+            if (hits.mirrors[s] != (s < context.mirrors.size() ? (int)s : -1))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Pixels a single leg can cover at most, as a percentage of the vacant area
+    double computeLegBound() const
+    {
+        auto [width, height] = temple.getShape();
+        int i0 = width, i1 = -1, j0 = height, j1 = -1;
+        for (int j = 0; j < height; ++j)
+        {
+            for (int i = 0; i < width; ++i)
+            {
+                if (!temple.isBlocked(i, j))
+                {
+                    i0 = std::min(i0, i);
+                    i1 = std::max(i1, i);
+                    j0 = std::min(j0, j);
+                    j1 = std::max(j1, j);
+                }
+            }
+        }
+        if (i1 < 0)
+        {
+            return 0;
+        }
+        double cell = temple.getBlockSize();
+        double longest = std::hypot((i1 - i0 + 1) * cell, (j1 - j0 + 1) * cell);
+
+        const ScoringContext &context = contexts.front();
+        double w = temple.getSpec().beam_half_width;
+        double r = context.scorer.getResolution();
+        double area = (2 * w * longest + M_PI * w * w) * r * r;
+        double perimeter = (2 * longest + 2 * M_PI * w) * r;
+        double pixels = area + perimeter / 2 + 1;
+        return 100.0 * pixels / (double)context.scorer.getVacantCount();
+    }
+};
+
+#endif // BRANCH_AND_BOUND_H
@@ -0,0 +1,469 @@
+#ifndef CMAES_H
+#define CMAES_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <vector>
+#include "SolutionSpace.h"
+#include "BatchEvaluator.h"
+
+enum class CMAESRestarts
+{
+    None,  // A single run
+    IPOP,  // Restart from a random point with twice the population each time
+    BIPOP, // Alternate large (doubling) and small (random, narrow) populations by evaluations spent
+};
+
+struct CMAESOptions
+{
+    double sigma = 5e-5;           // Initial step size of the first run, as a fraction of each dimension's extent
+    double restartSigma = 0.25;    // Initial step size of runs restarted from a random point
+    CMAESRestarts restarts = CMAESRestarts::BIPOP;
+    int maxRestarts = 9;
+    double seconds = 60;           // Wall-clock budget over all runs
+    long long maxEvaluations = -1; // Also stop after this many evaluations (< 0 for no limit)
+    int maxGenerations = 5000;     // Per run
+    double tolX = 1e-7;            // A run ends when every step is below this (in extents)
+    double maxCondition = 1e14;    // or the covariance gets this ill-conditioned
+    double penalty = 1.0;          // Fitness penalty per squared world unit the repair had to move a sample
+    bool report = true;            // Print the statistics of every generation
+    unsigned long long seed = 1;
+};
+
+// Statistics of one generation
+struct CMAESGeneration
+{
+    int run;
+    int generation;
+    int lambda;
+    long long evaluations;
+    double generationBest; // Best score of this generation
+    double best;           // Best score so far over all runs
+    double meanFitness;
+    double sigma;
+    double axisRatio;      // Square root of the covariance condition number
+};
+
+// CMA-ES (Hansen's (mu/mu_w, lambda) with rank-one and rank-mu updates) over
+// encoded solutions. Coordinates are scaled by their extent so one step size
+// fits positions and angles alike. Samples are drawn without wrapping, and only
+// the mean's angles are wrapped after each update, so the periodic dimensions
+// move through 0 / 2 pi without a seam. Each generation is repaired and scored
+// in parallel through the BatchEvaluator, and samples that needed repair are
+// penalized by how far they were moved. Sampling and selection are serial, so
+// a run is reproducible for a given seed with any number of threads.
+class CMAES
+{
+public:
+    CMAES(BatchEvaluator &evaluator, const CMAESOptions &options = CMAESOptions())
+        : evaluator(evaluator), space(evaluator.getSpace()), options(options), rng(options.seed)
+    {
+    }
+
+    // Optimize from x (an encoded solution). Returns the best score and leaves the
+    // best (repaired) solution in x.
+    double run(std::vector<double> &x)
+    {
+        n = space.dimensions();
+        scale.resize(n);
+        for (int d = 0; d < n; ++d)
+        {
+            scale[d] = space.extent(d);
+        }
+
+        start = std::chrono::steady_clock::now();
+        startEvaluations = evaluator.getEvaluations();
+        history.clear();
+
+        // The starting point itself counts, so a run never returns anything worse
+        std::vector<std::vector<double>> initial{x};
+        std::vector<double> initialScore;
+        evaluator.evaluate(initial, initialScore);
+        bestScore = initialScore[0];
+        bestX = initial[0];
+
+        const int defaultLambda = 4 + (int)(3 * std::log((double)n));
+        int largeLambda = defaultLambda;
+        long long largeEvaluations = 0;
+        long long smallEvaluations = 0;
+        int largeRuns = 0;
+
+        for (int r = 0; r <= maxRuns() && !outOfBudget(); ++r)
+        {
+            std::vector<double> mean(n);
+            double sigma;
+            int lambda;
+            bool small = false;
+            if (r == 0)
+            {
+                for (int d = 0; d < n; ++d)
+                {
+                    mean[d] = x[d] / scale[d];
+                }
+                sigma = options.sigma;
+                lambda = defaultLambda;
+            }
+            else
+            {
+                std::vector<double> point = space.randomPoint(rng);
+                for (int d = 0; d < n; ++d)
+                {
+                    mean[d] = point[d] / scale[d];
+                }
+                sigma = options.restartSigma;
+                small = options.restarts == CMAESRestarts::BIPOP && largeRuns > 0 && smallEvaluations < largeEvaluations;
+                if (small)
+                {
+                    double u = std::uniform_real_distribution<double>(0, 1)(rng);
+                    lambda = std::max(defaultLambda, (int)(defaultLambda * std::pow(0.5 * largeLambda / defaultLambda, u * u)));
+                    sigma *= std::pow(10.0, -2 * std::uniform_real_distribution<double>(0, 1)(rng));
+                }
+                else
+                {
+                    largeLambda *= 2;
+                    lambda = largeLambda;
+                    ++largeRuns;
+                }
+            }
+
+            long long before = evaluator.getEvaluations();
+            singleRun(r, mean, sigma, lambda);
+            (small ? smallEvaluations : largeEvaluations) += evaluator.getEvaluations() - before;
+        }
+
+        x = bestX;
+        return bestScore;
+    }
+
+    const std::vector<CMAESGeneration> &getHistory() const
+    {
+        return history;
+    }
+
+private:
+    BatchEvaluator &evaluator;
+    const SolutionSpace &space;
+    CMAESOptions options;
+    std::mt19937_64 rng;
+    std::chrono::steady_clock::time_point start;
+    long long startEvaluations = 0;
+
+    int n = 0;
+    std::vector<double> scale; // Extent of each dimension
+    std::vector<CMAESGeneration> history;
+    double bestScore = 0;
+    std::vector<double> bestX;
+
+    int maxRuns() const
+    {
+        return options.restarts == CMAESRestarts::None ? 0 : options.maxRestarts;
+    }
+
+    bool outOfBudget() const
+    {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return seconds >= options.seconds ||
+               (options.maxEvaluations >= 0 && evaluator.getEvaluations() - startEvaluations >= options.maxEvaluations);
+    }
+
+    // One CMA-ES run from the given mean (in extents)
+    void singleRun(int run, std::vector<double> mean, double sigma, int lambda)
+    {
+        const int mu = lambda / 2;
+        std::vector<double> weights(mu);
+        for (int i = 0; i < mu; ++i)
+        {
+            weights[i] = std::log(mu + 0.5) - std::log(i + 1.0);
+        }
+        double weightSum = std::accumulate(weights.begin(), weights.end(), 0.0);
+        double squareSum = 0;
+        for (double &w : weights)
+        {
+            w /= weightSum;
+            squareSum += w * w;
+        }
+        const double mueff = 1 / squareSum;
+
+        // Strategy parameters (Hansen's defaults)
+        const double cc = (4 + mueff / n) / (n + 4 + 2 * mueff / n);
+        const double cs = (mueff + 2) / (n + mueff + 5);
+        const double c1 = 2 / ((n + 1.3) * (n + 1.3) + mueff);
+        const double cmu = std::min(1 - c1, 2 * (mueff - 2 + 1 / mueff) / ((n + 2) * (n + 2) + mueff));
+        const double damps = 1 + 2 * std::max(0.0, std::sqrt((mueff - 1) / (n + 1)) - 1) + cs;
+        const double chiN = std::sqrt((double)n) * (1 - 1.0 / (4 * n) + 1.0 / (21.0 * n * n));
+        const int stallGenerations = 10 + (int)std::ceil(30.0 * n / lambda);
+
+        std::vector<double> pc(n, 0), ps(n, 0);
+        std::vector<double> C(n * n, 0), B(n * n, 0), D(n, 1), invSqrtC(n * n, 0);
+        for (int i = 0; i < n; ++i)
+        {
+            C[i * n + i] = B[i * n + i] = invSqrtC[i * n + i] = 1;
+        }
+        long long eigenAge = 0;
+
+        std::vector<std::vector<double>> samples(lambda, std::vector<double>(n));
+        std::vector<std::vector<double>> candidates(lambda);
+        std::vector<double> scores, fitness(lambda);
+        std::vector<int> order(lambda);
+        std::vector<double> z(n), oldMean(n), step(n), temp(n);
+        std::normal_distribution<double> gauss(0, 1);
+
+        double runBest = -std::numeric_limits<double>::infinity();
+        int sinceImprovement = 0;
+
+        for (int generation = 0; generation < options.maxGenerations && !outOfBudget(); ++generation)
+        {
+            // Sample x = mean + sigma * B * D * z
+            for (int k = 0; k < lambda; ++k)
+            {
+                for (int i = 0; i < n; ++i)
+                {
+                    z[i] = D[i] * gauss(rng);
+                }
+                for (int i = 0; i < n; ++i)
+                {
+                    double sum = 0;
+                    for (int j = 0; j < n; ++j)
+                    {
+                        sum += B[i * n + j] * z[j];
+                    }
+                    samples[k][i] = mean[i] + sigma * sum;
+                }
+                candidates[k].resize(n);
+                for (int d = 0; d < n; ++d)
+                {
+                    candidates[k][d] = samples[k][d] * scale[d];
+                }
+                space.normalize(candidates[k]);
+            }
+
+            evaluator.evaluate(candidates, scores);
+
+            // Penalize samples by how far normalize + repair moved them
+            for (int k = 0; k < lambda; ++k)
+            {
+                double moved = 0;
+                for (int d = 0; d < n; ++d)
+                {
+                    double delta = SolutionSpace::difference(d, candidates[k][d], samples[k][d] * scale[d]);
+                    if (!SolutionSpace::isAngle(d))
+                    {
+                        moved += delta * delta;
+                    }
+                }
+                fitness[k] = scores[k] - options.penalty * moved;
+                if (scores[k] > bestScore)
+                {
+                    bestScore = scores[k];
+                    bestX = candidates[k];
+                }
+            }
+
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(), [&](int a, int b)
+                             { return fitness[a] > fitness[b]; });
+
+            // Mean update
+            oldMean = mean;
+            std::fill(mean.begin(), mean.end(), 0.0);
+            for (int i = 0; i < mu; ++i)
+            {
+                for (int d = 0; d < n; ++d)
+                {
+                    mean[d] += weights[i] * samples[order[i]][d];
+                }
+            }
+            for (int d = 0; d < n; ++d)
+            {
+                step[d] = (mean[d] - oldMean[d]) / sigma;
+            }
+
+            // Evolution paths
+            double psNorm = 0;
+            for (int i = 0; i < n; ++i)
+            {
+                double sum = 0;
+                for (int j = 0; j < n; ++j)
+                {
+                    sum += invSqrtC[i * n + j] * step[j];
+                }
+                ps[i] = (1 - cs) * ps[i] + std::sqrt(cs * (2 - cs) * mueff) * sum;
+                psNorm += ps[i] * ps[i];
+            }
+            psNorm = std::sqrt(psNorm);
+            bool hsig = psNorm / std::sqrt(1 - std::pow(1 - cs, 2.0 * (generation + 1))) / chiN < 1.4 + 2.0 / (n + 1);
+            for (int i = 0; i < n; ++i)
+            {
+                pc[i] = (1 - cc) * pc[i] + (hsig ? std::sqrt(cc * (2 - cc) * mueff) * step[i] : 0);
+            }
+
+            // Covariance: rank-one and rank-mu updates
+            for (int i = 0; i < n; ++i)
+            {
+                for (int j = 0; j <= i; ++j)
+                {
+                    double rankMu = 0;
+                    for (int k = 0; k < mu; ++k)
+                    {
+                        const std::vector<double> &x = samples[order[k]];
+                        rankMu += weights[k] * (x[i] - oldMean[i]) * (x[j] - oldMean[j]);
+                    }
+                    rankMu /= sigma * sigma;
+                    double value = (1 - c1 - cmu) * C[i * n + j] +
+                                   c1 * (pc[i] * pc[j] + (hsig ? 0 : cc * (2 - cc) * C[i * n + j])) +
+                                   cmu * rankMu;
+                    C[i * n + j] = C[j * n + i] = value;
+                }
+            }
+
+            sigma *= std::exp((cs / damps) * (psNorm / chiN - 1));
+
+            // Wrap the mean's angles, the samples of the next generation are relative to it
+            for (int d = 0; d < n; ++d)
+            {
+                if (SolutionSpace::isAngle(d))
+                {
+                    mean[d] = SolutionSpace::wrapAngle(mean[d] * scale[d]) / scale[d];
+                }
+            }
+
+            // Refresh B and D once in a while, C changes slowly
+            eigenAge += lambda;
+            if (eigenAge > lambda / (c1 + cmu) / n / 10)
+            {
+                eigenAge = 0;
+                eigen(C, B, D);
+                for (int i = 0; i < n; ++i)
+                {
+                    D[i] = std::sqrt(std::max(D[i], 1e-300));
+                }
+                for (int i = 0; i < n; ++i)
+                {
+                    for (int j = 0; j < n; ++j)
+                    {
+                        double sum = 0;
+                        for (int k = 0; k < n; ++k)
+                        {
+                            sum += B[i * n + k] * B[j * n + k] / D[k];
+                        }
+                        invSqrtC[i * n + j] = sum;
+                    }
+                }
+            }
+
+            double maxD = *std::max_element(D.begin(), D.end());
+            double minD = *std::min_element(D.begin(), D.end());
+
+            CMAESGeneration stats;
+            stats.run = run;
+            stats.generation = generation;
+            stats.lambda = lambda;
+            stats.evaluations = evaluator.getEvaluations() - startEvaluations;
+            stats.generationBest = *std::max_element(scores.begin(), scores.end());
+            stats.best = bestScore;
+            stats.meanFitness = std::accumulate(fitness.begin(), fitness.end(), 0.0) / lambda;
+            stats.sigma = sigma;
+            stats.axisRatio = maxD / minD;
+            history.push_back(stats);
+            if (options.report)
+            {
+                printf("Run %d generation %d: lambda = %d, evaluations = %lld, generation best = %.4f, best = %.4f, mean fitness = %.4f, sigma = %.3g, axis ratio = %.3g\n",
+                       stats.run, stats.generation, stats.lambda, stats.evaluations, stats.generationBest,
+                       stats.best, stats.meanFitness, stats.sigma, stats.axisRatio);
+            }
+
+            // Termination of this run
+            if (stats.generationBest > runBest + 1e-9)
+            {
+                runBest = stats.generationBest;
+                sinceImprovement = 0;
+            }
+            else if (++sinceImprovement >= stallGenerations)
+            {
+                break;
+            }
+            if (sigma * maxD < options.tolX || stats.axisRatio * stats.axisRatio > options.maxCondition)
+            {
+                break;
+            }
+        }
+    }
+
+    // Eigen-decomposition of the symmetric matrix A (cyclic Jacobi): A = B diag(values) B^T
+    static void eigen(const std::vector<double> &A, std::vector<double> &B, std::vector<double> &values)
+    {
+        const int n = values.size();
+        std::vector<double> a = A;
+        std::fill(B.begin(), B.end(), 0.0);
+        for (int i = 0; i < n; ++i)
+        {
+            B[i * n + i] = 1;
+        }
+
+        for (int sweep = 0; sweep < 100; ++sweep)
+        {
+            double offDiagonal = 0;
+            for (int p = 0; p < n; ++p)
+            {
+                for (int q = p + 1; q < n; ++q)
+                {
+                    offDiagonal += a[p * n + q] * a[p * n + q];
+                }
+            }
+            if (offDiagonal < 1e-30)
+            {
+                break;
+            }
+
+            for (int p = 0; p < n; ++p)
+            {
+                for (int q = p + 1; q < n; ++q)
+                {
+                    double apq = a[p * n + q];
+                    if (std::fabs(apq) < 1e-300)
+                    {
+                        continue;
+                    }
+                    double theta = (a[q * n + q] - a[p * n + p]) / (2 * apq);
+                    double t = (theta >= 0 ? 1 : -1) / (std::fabs(theta) + std::sqrt(theta * theta + 1));
+                    double c = 1 / std::sqrt(t * t + 1);
+                    double s = t * c;
+
+                    for (int k = 0; k < n; ++k)
+                    {
+                        double akp = a[k * n + p];
+                        double akq = a[k * n + q];
+                        a[k * n + p] = c * akp - s * akq;
+                        a[k * n + q] = s * akp + c * akq;
+                    }
+                    for (int k = 0; k < n; ++k)
+                    {
+                        double apk = a[p * n + k];
+                        double aqk = a[q * n + k];
+                        a[p * n + k] = c * apk - s * aqk;
+                        a[q * n + k] = s * apk + c * aqk;
+                    }
+                    for (int k = 0; k < n; ++k)
+                    {
+                        double bkp = B[k * n + p];
+                        double bkq = B[k * n + q];
+                        B[k * n + p] = c * bkp - s * bkq;
+                        B[k * n + q] = s * bkp + c * bkq;
+                    }
+                }
+            }
+        }
+
+        for (int i = 0; i < n; ++i)
+        {
+            values[i] = a[i * n + i];
+        }
+    }
+};
+
+#endif // CMAES_H
@@ -0,0 +1,245 @@
+#ifndef DIFFERENTIAL_EVOLUTION_H
+#define DIFFERENTIAL_EVOLUTION_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "SolutionSpace.h"
+#include "BatchEvaluator.h"
+
+struct DEOptions
+{
+    int populationSize = 60;
+    double F = 0.5;               // Differential weight
+    double CR = 0.9;              // Crossover rate
+    bool selfAdaptive = true;     // jDE: every individual carries its own F and CR
+    double tauF = 0.1;            // jDE: probability of drawing a new F
+    double tauCR = 0.1;           // jDE: probability of drawing a new CR
+    double minF = 0.1;            // jDE: new F values are uniform in [minF, minF + rangeF]
+    double rangeF = 0.9;
+    int maxGenerations = 100000;
+    double seconds = 60;          // Wall-clock budget of run()
+    int reportEvery = 10;         // Progress line every this many generations (0 for none)
+    unsigned long long seed = 1;
+};
+
+// Differential evolution, DE/rand-to-best/1/bin, over encoded solutions:
+//   v = x_r1 + F * (x_best - x_r1) + F * (x_r2 - x_r3)
+// followed by binomial crossover with the target. Differences of angles go the
+// short way around. With jDE self-adaptation each individual keeps its own F and
+// CR, occasionally redrawn, and keeps them only when its trial wins. A trial
+// replaces its target when it scores at least as well, which lets the
+// population drift across the many plateaus of the coverage score.
+//
+// All trial vectors of a generation are built serially from one random stream
+// and then repaired and scored in one parallel batch, so runs are reproducible
+// for a given seed. step() runs a single generation, for drivers such as the
+// island model that interleave several populations.
+class DifferentialEvolution
+{
+public:
+    DifferentialEvolution(BatchEvaluator &evaluator, const DEOptions &options = DEOptions())
+        : evaluator(evaluator), space(evaluator.getSpace()), options(options), rng(options.seed)
+    {
+    }
+
+    // Random population; the given points (if any) replace the first members
+    void initialize(const std::vector<std::vector<double>> &seeds = {})
+    {
+        const int size = std::max(4, options.populationSize);
+        population.clear();
+        for (int i = 0; i < size; ++i)
+        {
+            population.push_back(i < (int)seeds.size() ? seeds[i] : space.randomPoint(rng));
+            space.normalize(population.back());
+        }
+        evaluator.evaluate(population, scores);
+        F.assign(size, options.F);
+        CR.assign(size, options.CR);
+        generation = 0;
+        updateBest();
+    }
+
+    // One generation: build all trials, score them in a batch, select
+    void step()
+    {
+        const int size = population.size();
+        const int dimensions = space.dimensions();
+        std::uniform_real_distribution<double> uniform(0, 1);
+        std::uniform_int_distribution<int> pick(0, size - 1);
+        std::uniform_int_distribution<int> pickDimension(0, dimensions - 1);
+
+        trials.resize(size);
+        trialF.resize(size);
+        trialCR.resize(size);
+        for (int i = 0; i < size; ++i)
+        {
+            double f = F[i];
+            double cr = CR[i];
+            if (options.selfAdaptive)
+            {
+                if (uniform(rng) < options.tauF)
+                {
+                    f = options.minF + uniform(rng) * options.rangeF;
+                }
+                if (uniform(rng) < options.tauCR)
+                {
+                    cr = uniform(rng);
+                }
+            }
+            trialF[i] = f;
+            trialCR[i] = cr;
+
+            int r1, r2, r3;
+            do
+            {
+                r1 = pick(rng);
+            } while (r1 == i);
+            do
+            {
+                r2 = pick(rng);
+            } while (r2 == i || r2 == r1);
+            do
+            {
+                r3 = pick(rng);
+            } while (r3 == i || r3 == r1 || r3 == r2);
+
+            const std::vector<double> &a = population[r1];
+            const std::vector<double> &b = population[r2];
+            const std::vector<double> &c = population[r3];
+            const std::vector<double> &best = population[bestIndex];
+            std::vector<double> &trial = trials[i];
+            trial = population[i];
+            int forced = pickDimension(rng);
+            for (int d = 0; d < dimensions; ++d)
+            {
+                if (d == forced || uniform(rng) < cr)
+                {
+                    trial[d] = a[d] + f * SolutionSpace::difference(d, best[d], a[d]) +
+                               f * SolutionSpace::difference(d, b[d], c[d]);
+                }
+            }
+            space.normalize(trial);
+        }
+
+        evaluator.evaluate(trials, trialScores);
+
+        for (int i = 0; i < size; ++i)
+        {
+            if (trialScores[i] >= scores[i])
+            {
+                population[i].swap(trials[i]);
+                scores[i] = trialScores[i];
+                F[i] = trialF[i];
+                CR[i] = trialCR[i];
+            }
+        }
+        ++generation;
+        updateBest();
+    }
+
+    // Evolve from x (kept as one member of the initial population, followed by any extra
+    // seeds) until the budget is spent. Returns the best score and leaves the best solution in x.
+    double run(std::vector<double> &x, const std::vector<std::vector<double>> &extraSeeds = {})
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::vector<double>> seeds{x};
+        seeds.insert(seeds.end(), extraSeeds.begin(), extraSeeds.end());
+        initialize(seeds);
+        while (generation < options.maxGenerations &&
+               std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < options.seconds)
+        {
+            step();
+            if (options.reportEvery > 0 && generation % options.reportEvery == 0)
+            {
+                printf("Generation %d: best = %.4f, mean = %.4f, mean F = %.3f, mean CR = %.3f, evaluations = %lld\n",
+                       generation, getBestScore(), meanScore(), mean(F), mean(CR), evaluator.getEvaluations());
+            }
+        }
+        x = getBest();
+        return getBestScore();
+    }
+
+    const std::vector<double> &getBest() const
+    {
+        return population[bestIndex];
+    }
+
+    double getBestScore() const
+    {
+        return scores[bestIndex];
+    }
+
+    int getGeneration() const
+    {
+        return generation;
+    }
+
+    // Access to the members, for migration between populations
+    int size() const
+    {
+        return population.size();
+    }
+
+    const std::vector<double> &getMember(int i) const
+    {
+        return population[i];
+    }
+
+    double getScore(int i) const
+    {
+        return scores[i];
+    }
+
+    int getWorst() const
+    {
+        return std::min_element(scores.begin(), scores.end()) - scores.begin();
+    }
+
+    // Replace member i by an already scored solution
+    void replace(int i, const std::vector<double> &x, double score)
+    {
+        population[i] = x;
+        scores[i] = score;
+        updateBest();
+    }
+
+    double meanScore() const
+    {
+        return mean(scores);
+    }
+
+private:
+    BatchEvaluator &evaluator;
+    const SolutionSpace &space;
+    DEOptions options;
+    std::mt19937_64 rng;
+
+    std::vector<std::vector<double>> population;
+    std::vector<double> scores;
+    std::vector<double> F, CR;
+    int bestIndex = 0;
+    int generation = 0;
+
+    std::vector<std::vector<double>> trials;
+    std::vector<double> trialScores, trialF, trialCR;
+
+    void updateBest()
+    {
+        bestIndex = std::max_element(scores.begin(), scores.end()) - scores.begin();
+    }
+
+    static double mean(const std::vector<double> &values)
+    {
+        double sum = 0;
+        for (double value : values)
+        {
+            sum += value;
+        }
+        return values.empty() ? 0 : sum / values.size();
+    }
+};
+
+#endif // DIFFERENTIAL_EVOLUTION_H
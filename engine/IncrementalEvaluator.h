@@ -0,0 +1,200 @@
+#ifndef INCREMENTAL_EVALUATOR_H
+#define INCREMENTAL_EVALUATOR_H
+
+#include "../math/Vector2.h"
+#include "Temple.h"
+#include "Lamp.h"
+#include "Mirror.h"
+#include "Validation.h"
+#include "MirrorBVH.h"
+#include "IncrementalScorer.h"
+#include <vector>
+#include <limits>
+
+// Lamp, mirrors, their traced path and its score, updated one element at a time.
+// When a mirror moves, the path up to the first segment that the old or the new
+// mirror touches is kept, only the tail is traced again and only the tail's
+// pixel rows are recounted. The last move can be undone with revert(). Scores
+// are identical to a full raytrace + Scorer.
+class IncrementalEvaluator {
+public:
+    IncrementalEvaluator(const Temple& temple, int pixelsPerUnit = 20)
+        : temple(&temple), lamp({0, 0}, 0), scorer(temple, pixelsPerUnit), savedLamp({0, 0}, 0) {
+    }
+
+    // Trace and score a whole solution
+    double reset(const Lamp& newLamp, const std::vector<Mirror>& newMirrors) {
+        lamp = newLamp;
+        mirrors = newMirrors;
+        useBVH = mirrors.size() >= Validation::bvhMirrorThreshold;
+        if (useBVH) {
+            bvh.build(mirrors);
+        }
+        retrace(0);
+        currentScore = scorer.reset(path);
+        canRevert = false;
+        return currentScore;
+    }
+
+    double moveLamp(const Vector2& position, double angle) {
+        save(-1, 0);
+        lamp.updateLamp(position, angle);
+        return finishMove(0);
+    }
+
+    double moveMirror(int index, const Vector2& position, double angle) {
+        Mirror& mirror = mirrors[index];
+        save(index, firstHit(index));
+        mirror.updateMirror(position, angle);
+        if (useBVH) {
+            bvh.refit(mirrors, index);
+        }
+        return finishMove(std::min(savedReused, firstCrossing(mirror)));
+    }
+
+    // Undo the last move
+    void revert() {
+        if (!canRevert) {
+            return;
+        }
+        if (savedIndex < 0) {
+            lamp = savedLamp;
+        } else {
+            mirrors[savedIndex] = savedMirror.front();
+            if (useBVH) {
+                bvh.refit(mirrors, savedIndex);
+            }
+        }
+        path.points.resize(savedReused);
+        path.directions.resize(savedReused);
+        hits.mirrors.resize(savedReused);
+        hits.params.resize(savedReused);
+        path.points.insert(path.points.end(), savedPath.points.begin(), savedPath.points.end());
+        path.directions.insert(path.directions.end(), savedPath.directions.begin(), savedPath.directions.end());
+        hits.mirrors.insert(hits.mirrors.end(), savedHits.mirrors.begin(), savedHits.mirrors.end());
+        hits.params.insert(hits.params.end(), savedHits.params.begin(), savedHits.params.end());
+        if (scorerChanged) {
+            scorer.revert();
+        }
+        currentScore = savedScore;
+        canRevert = false;
+    }
+
+    double score() const {
+        return currentScore;
+    }
+
+    const Lamp& getLamp() const {
+        return lamp;
+    }
+
+    const std::vector<Mirror>& getMirrors() const {
+        return mirrors;
+    }
+
+    const Path& getPath() const {
+        return path;
+    }
+
+    // Path segments reused by the last move
+    size_t lastReused() const {
+        return reused;
+    }
+
+private:
+    const Temple* temple;
+    Lamp lamp;
+    std::vector<Mirror> mirrors;
+    MirrorBVH bvh;
+    bool useBVH = false;
+    Path path;
+    TraceHits hits;
+    IncrementalScorer scorer;
+    double currentScore = 0;
+    size_t reused = 0;
+
+    // Undo state of the last move
+    bool canRevert = false;
+    int savedIndex = -1;
+    Lamp savedLamp;
+    std::vector<Mirror> savedMirror; // Holds at most one mirror (Mirror has no default constructor)
+    size_t savedReused = 0;
+    Path savedPath; // Tail from segment savedReused on, including its start point
+    TraceHits savedHits;
+    double savedScore = 0;
+    bool scorerChanged = false;
+
+    // First segment that ends on mirror index, or the segment count
+    size_t firstHit(int index) const {
+        for (size_t s = 0; s < hits.mirrors.size(); ++s) {
+            if (hits.mirrors[s] == index) {
+                return s;
+            }
+        }
+        return hits.mirrors.size();
+    }
+
+    // First segment that the mirror reaches no later than the segment's own hit, or the segment count
+    size_t firstCrossing(const Mirror& mirror) const {
+        const double epsilon = 1e-12; // Same threshold as the tracer
+        for (size_t s = 0; s < hits.params.size(); ++s) {
+            Ray ray(path.points[s], path.directions[s]);
+            auto [caseType, t, u] = Validation::ray_segment_intersection(ray, mirror.s);
+            if ((caseType == 2 || caseType == 3) && t > epsilon && t <= hits.params[s]) {
+                return s;
+            }
+        }
+        return hits.mirrors.size();
+    }
+
+    // Remember the state before moving element index (-1 for the lamp)
+    void save(int index, size_t reusable) {
+        savedIndex = index;
+        if (index < 0) {
+            savedLamp = lamp;
+        } else {
+            savedMirror.assign(1, mirrors[index]);
+        }
+        savedReused = reusable;
+        savedScore = currentScore;
+    }
+
+    double finishMove(size_t unchanged) {
+        // Keep the tail for revert()
+        unchanged = std::min(unchanged, hits.mirrors.size());
+        savedReused = unchanged;
+        savedPath.points.assign(path.points.begin() + unchanged, path.points.end());
+        savedPath.directions.assign(path.directions.begin() + unchanged, path.directions.end());
+        savedHits.mirrors.assign(hits.mirrors.begin() + unchanged, hits.mirrors.end());
+        savedHits.params.assign(hits.params.begin() + unchanged, hits.params.end());
+        canRevert = true;
+        reused = unchanged;
+
+        scorerChanged = unchanged < hits.mirrors.size();
+        if (scorerChanged) {
+            retrace(unchanged);
+            currentScore = scorer.update(path, unchanged);
+        }
+        return currentScore;
+    }
+
+    // Drop the path after segment `from` and trace it again from there
+    void retrace(size_t from) {
+        if (from == 0) {
+            path.points.assign(1, lamp.v);
+            path.directions.clear();
+            hits.mirrors.clear();
+            hits.params.clear();
+            Validation::trace_from(*temple, mirrors, useBVH ? &bvh : nullptr, Ray(lamp.v, lamp.direction), path, &hits);
+            return;
+        }
+        Ray ray(path.points[from], path.directions[from]);
+        path.points.resize(from + 1);
+        path.directions.resize(from);
+        hits.mirrors.resize(from);
+        hits.params.resize(from);
+        Validation::trace_from(*temple, mirrors, useBVH ? &bvh : nullptr, ray, path, &hits);
+    }
+};
+
+#endif // INCREMENTAL_EVALUATOR_H
@@ -0,0 +1,161 @@
+#ifndef INCREMENTAL_SCORER_H
+#define INCREMENTAL_SCORER_H
+
+#include "Temple.h"
+#include "Validation.h"
+#include "Scorer.h"
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+// Scorer for a path that changes only from some segment on, as it does when a
+// single mirror moves. The row spans of every capsule are kept, so an update
+// only removes the spans of the old tail, rasterizes the new tail and recounts
+// the pixel rows either of them touches. The last update can be undone, which
+// is what a rejected annealing move needs. Results are identical to Scorer.
+class IncrementalScorer {
+public:
+    IncrementalScorer(const Temple& temple, int pixelsPerUnit = 20)
+        : scorer(temple, pixelsPerUnit),
+          rows(scorer.getPixelRows()),
+          rowCounts(scorer.getPixelRows(), 0),
+          rowStamps(scorer.getPixelRows(), 0) {
+    }
+
+    // Score a path from scratch
+    double reset(const Path& path) {
+        for (const auto& segmentRowList : segmentRows) {
+            for (int py : segmentRowList) {
+                rows[py].clear();
+                rowCounts[py] = 0;
+            }
+        }
+        segmentRows.clear();
+        illuminatedCount = 0;
+        journal.clear();
+        savedTail.clear();
+        return update(path, 0);
+    }
+
+    // Score a path whose first `unchanged` segments are those of the previously scored path
+    double update(const Path& path, size_t unchanged) {
+        unchanged = std::min(unchanged, segmentRows.size());
+        journal.clear();
+        savedIlluminated = illuminatedCount;
+        savedUnchanged = unchanged;
+        savedTail.assign(segmentRows.begin() + unchanged, segmentRows.end());
+        ++stamp;
+
+        // Drop the spans of the old tail
+        for (size_t s = unchanged; s < segmentRows.size(); ++s) {
+            for (int py : segmentRows[s]) {
+                touchRow(py, unchanged);
+            }
+        }
+        segmentRows.resize(unchanged);
+
+        // Rasterize the new tail
+        size_t segments = capsuleCount(path);
+        for (size_t s = unchanged; s < segments; ++s) {
+            const Vector2& a = path.points[s];
+            const Vector2& b = path.points.size() == 1 ? a : path.points[s + 1];
+            segmentRows.emplace_back();
+            scorer.forEachCapsuleRow(a, b, [&](int py, int colBegin, int colEnd) {
+                touchRow(py, unchanged);
+                rows[py].push_back({(int)s, colBegin, colEnd});
+                segmentRows.back().push_back(py);
+            });
+        }
+
+        // Recount the touched rows
+        for (const SavedRow& saved : journal) {
+            std::vector<std::pair<int, int>>& spans = scratch;
+            spans.clear();
+            for (const Span& span : rows[saved.row]) {
+                spans.emplace_back(span.begin, span.end);
+            }
+            long long count = scorer.vacantInSpans(saved.row, spans);
+            illuminatedCount += count - rowCounts[saved.row];
+            rowCounts[saved.row] = count;
+        }
+        return score();
+    }
+
+    // Undo the last update
+    void revert() {
+        for (SavedRow& saved : journal) {
+            rows[saved.row].swap(saved.spans);
+            rowCounts[saved.row] = saved.count;
+        }
+        journal.clear();
+        segmentRows.resize(savedUnchanged);
+        segmentRows.insert(segmentRows.end(), savedTail.begin(), savedTail.end());
+        savedTail.clear();
+        illuminatedCount = savedIlluminated;
+    }
+
+    double score() const {
+        long long vacant = scorer.getVacantCount();
+        return vacant == 0 ? 0 : 100.0 * (double)illuminatedCount / (double)vacant;
+    }
+
+    long long getIlluminatedCount() const {
+        return illuminatedCount;
+    }
+
+private:
+    struct Span {
+        int segment;
+        int begin;
+        int end;
+    };
+
+    struct SavedRow {
+        int row;
+        std::vector<Span> spans;
+        long long count;
+    };
+
+    Scorer scorer; // Rasterization and vacant pixel counting
+    std::vector<std::vector<Span>> rows;
+    std::vector<long long> rowCounts;
+    std::vector<std::vector<int>> segmentRows; // Pixel rows covered by each capsule
+    long long illuminatedCount = 0;
+
+    // Undo state of the last update
+    std::vector<SavedRow> journal;
+    std::vector<std::vector<int>> savedTail;
+    size_t savedUnchanged = 0;
+    long long savedIlluminated = 0;
+
+    std::vector<unsigned long long> rowStamps; // Update that last touched each row; 64 bits never wrap
+    unsigned long long stamp = 0;
+    std::vector<std::pair<int, int>> scratch;
+
+    static size_t capsuleCount(const Path& path) {
+        if (path.points.empty()) {
+            return 0;
+        }
+        return path.points.size() == 1 ? 1 : path.points.size() - 1;
+    }
+
+    // The first time a row is touched by an update, save it and drop the spans of the changed segments
+    void touchRow(int py, size_t unchanged) {
+        if (rowStamps[py] == stamp) {
+            return;
+        }
+        rowStamps[py] = stamp;
+        journal.push_back({py, rows[py], rowCounts[py]});
+
+        std::vector<Span>& spans = rows[py];
+        size_t kept = 0;
+        for (const Span& span : spans) {
+            if ((size_t)span.segment < unchanged) {
+                spans[kept++] = span;
+            }
+        }
+        spans.resize(kept);
+    }
+};
+
+#endif // INCREMENTAL_SCORER_H
@@ -0,0 +1,197 @@
+#ifndef ISLAND_MODEL_H
+#define ISLAND_MODEL_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <numeric>
+#include <thread>
+#include <vector>
+#include "Temple.h"
+#include "SolutionSpace.h"
+#include "ScoringContext.h"
+#include "ThreadPool.h"
+#include "BatchEvaluator.h"
+#include "DifferentialEvolution.h"
+#include "Mailbox.h"
+
+struct IslandOptions
+{
+    int islands = 0;              // Populations, each on its own thread (0 for one per hardware thread)
+    int populationSize = 60;      // Members per island
+    int migrationInterval = 50;   // Generations between two migrations of an island
+    int migrants = 1;             // Best members sent to the next island on the ring per migration
+    int mailboxCapacity = 16;     // Migrants in flight per link; an island that falls behind loses the rest
+    double seconds = 60;          // Wall-clock budget
+    unsigned long long seed = 1;  // Island i uses seed + i
+    bool report = true;
+};
+
+// Island model over differential evolution. Every island is a population with
+// its own thread, scoring context and random stream, evolving on its own; even
+// islands self-adapt F and CR (jDE), odd ones keep a fixed, more explorative
+// setting, so the islands don't all converge the same way. Every
+// migrationInterval generations an island sends copies of its best members to
+// the next island on a ring, and every generation it takes in whatever reached
+// its own mailbox, each migrant replacing the worst member if it scores better.
+//
+// The links are single-producer single-consumer lock-free mailboxes (see
+// Mailbox), so no island ever waits for another and the model scales with the
+// number of cores. The flip side is that migration timing depends on thread
+// scheduling: unlike the single-population solvers, runs are not reproducible.
+class IslandModel
+{
+public:
+    IslandModel(const Temple &temple, int pixelsPerUnit, const IslandOptions &options = IslandOptions())
+        : temple(temple), pixelsPerUnit(pixelsPerUnit), options(options)
+    {
+        if (this->options.islands <= 0)
+        {
+            this->options.islands = std::max(1u, std::thread::hardware_concurrency());
+        }
+    }
+
+    // Evolve all islands for the budget. x joins the first island and the seeds are dealt
+    // to the islands in turn; returns the best score and leaves the best solution in x.
+    double run(std::vector<double> &x, const std::vector<std::vector<double>> &seeds = {})
+    {
+        const int count = options.islands;
+        std::vector<std::unique_ptr<Island>> islands;
+        std::vector<std::unique_ptr<Mailbox<Migrant>>> mailboxes; // mailboxes[i] is island i's inbox
+        for (int i = 0; i < count; ++i)
+        {
+            islands.push_back(std::make_unique<Island>(temple, pixelsPerUnit, islandOptions(i)));
+            mailboxes.push_back(std::make_unique<Mailbox<Migrant>>(options.mailboxCapacity));
+        }
+        std::vector<std::vector<std::vector<double>>> islandSeeds(count);
+        islandSeeds[0].push_back(x);
+        for (size_t s = 0; s < seeds.size(); ++s)
+        {
+            islandSeeds[(s + 1) % count].push_back(seeds[s]);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (int i = 0; i < count; ++i)
+        {
+            threads.emplace_back([&, i]
+                                 { evolve(*islands[i], islandSeeds[i], *mailboxes[i], *mailboxes[(i + 1) % count], start); });
+        }
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+
+        int best = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            const Island &island = *islands[i];
+            if (island.de.getBestScore() > islands[best]->de.getBestScore())
+            {
+                best = i;
+            }
+            if (options.report)
+            {
+                printf("Island %d: best = %.4f after %d generations, %d migrants taken in, %d sent, %d dropped\n", i,
+                       island.de.getBestScore(), island.de.getGeneration(), island.accepted, island.sent, island.dropped);
+            }
+        }
+        x = islands[best]->de.getBest();
+        if (options.report)
+        {
+            printf("Island model finished: best = %.4f on island %d\n", islands[best]->de.getBestScore(), best);
+        }
+        return islands[best]->de.getBestScore();
+    }
+
+private:
+    struct Migrant
+    {
+        std::vector<double> x;
+        double score = 0;
+    };
+
+    // One population with everything it needs to run on its own thread. The pool has a
+    // single worker, so batches are scored inline on the island's thread.
+    struct Island
+    {
+        ThreadPool pool;
+        std::vector<ScoringContext> contexts;
+        BatchEvaluator evaluator;
+        DifferentialEvolution de;
+        int sent = 0;
+        int accepted = 0;
+        int dropped = 0;
+
+        Island(const Temple &temple, int pixelsPerUnit, const DEOptions &options)
+            : pool(1), contexts{ScoringContext(temple, pixelsPerUnit)}, evaluator(temple, pool, contexts),
+              de(evaluator, options)
+        {
+        }
+    };
+
+    const Temple &temple;
+    int pixelsPerUnit;
+    IslandOptions options;
+
+    DEOptions islandOptions(int i) const
+    {
+        DEOptions de;
+        de.populationSize = options.populationSize;
+        de.seed = options.seed + i;
+        de.reportEvery = 0;
+        if (i % 2 == 1)
+        {
+            de.selfAdaptive = false;
+            de.F = 0.8;
+            de.CR = 0.5;
+        }
+        return de;
+    }
+
+    void evolve(Island &island, const std::vector<std::vector<double>> &seeds, Mailbox<Migrant> &inbox,
+                Mailbox<Migrant> &outbox, std::chrono::steady_clock::time_point start)
+    {
+        DifferentialEvolution &de = island.de;
+        de.initialize(seeds);
+        std::vector<int> order(de.size());
+        Migrant migrant;
+        while (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < options.seconds)
+        {
+            de.step();
+
+            // A lone island's ring leads back to itself, so it has no one to migrate to
+            if (options.islands > 1 && de.getGeneration() % options.migrationInterval == 0)
+            {
+                std::iota(order.begin(), order.end(), 0);
+                const int migrants = std::min<int>(options.migrants, order.size());
+                std::partial_sort(order.begin(), order.begin() + migrants, order.end(), [&](int a, int b)
+                                  { return de.getScore(a) > de.getScore(b); });
+                for (int m = 0; m < migrants; ++m)
+                {
+                    if (outbox.push({de.getMember(order[m]), de.getScore(order[m])}))
+                    {
+                        ++island.sent;
+                    }
+                    else
+                    {
+                        ++island.dropped;
+                    }
+                }
+            }
+
+            while (inbox.pop(migrant))
+            {
+                int worst = de.getWorst();
+                if (migrant.score > de.getScore(worst))
+                {
+                    de.replace(worst, migrant.x, migrant.score);
+                    ++island.accepted;
+                }
+            }
+        }
+    }
+};
+
+#endif // ISLAND_MODEL_H
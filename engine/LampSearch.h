@@ -0,0 +1,237 @@
+#ifndef LAMP_SEARCH_H
+#define LAMP_SEARCH_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "../math/Vector2.h"
+#include "Temple.h"
+#include "Lamp.h"
+#include "Mirror.h"
+#include "Validation.h"
+#include "ScoringContext.h"
+#include "ThreadPool.h"
+#include "Repair.h"
+#include "Symmetry.h"
+#include "BoundaryPoses.h"
+
+struct LampSearchOptions
+{
+    double positionStep = 0.25;   // Grid of candidate lamp positions over the vacant cells and along the faces
+    int rayCount = 360;           // Chords cast from every position to rank it
+    int topPositions = 64;        // Best-ranked positions whose angles are swept exactly
+    int uniformAngles = 72;       // Evenly spaced angles swept besides the critical ones
+    double eventOffset = 1e-6;    // Angles are tried this far either side of every corner direction
+    bool report = true;
+};
+
+struct LampCandidate
+{
+    Lamp lamp = Lamp({0, 0}, 0);
+    double heuristic = 0; // Longest chord through the position
+    double score = 0;     // Exact coverage of the pose with the given mirrors
+};
+
+// Lamp placement in two stages. First every position on a grid over the vacant
+// cells and along the block faces (see BoundaryPoses) is ranked by its
+// visibility polygon, cast as rayCount chords: a lamp alone lights one chord,
+// so positions are ranked by the longest one (the mean breaks ties). Without
+// mirrors, positions symmetric to another candidate are skipped (see
+// Symmetry). Then the angles of the best positions are swept exactly. The chord
+// length is smooth in the angle except where the ray passes a block corner, and
+// a beam from a fixed point to a flat wall only gets longer as it turns towards
+// the corner at the end of it, so the best angles sit just either side of the
+// directions to visible corners. Those critical angles are scored, together
+// with a few evenly spaced ones for beams that gain from keeping off a corner
+// or meet the mirrors.
+//
+// Both stages run in parallel over positions, one scoring context per worker.
+// Ties keep the first candidate in grid order, so the result doesn't depend on
+// the thread count.
+class LampSearch
+{
+public:
+    LampSearch(const Temple &temple, ThreadPool &pool, std::vector<ScoringContext> &contexts,
+               const LampSearchOptions &options = LampSearchOptions())
+        : temple(temple), pool(pool), contexts(contexts), options(options)
+    {
+        corners = blockCorners();
+    }
+
+    // Best lamp pose for the given mirrors, which stay in place
+    LampCandidate run(const std::vector<Mirror> &mirrors)
+    {
+        std::vector<LampCandidate> ranked = rankPositions(mirrors.empty());
+        if (ranked.empty())
+        {
+            return LampCandidate();
+        }
+        ranked.resize(std::min<size_t>(ranked.size(), std::max(1, options.topPositions)));
+
+        std::vector<LampCandidate> best(ranked.size());
+        std::vector<long long> counts(ranked.size());
+        pool.parallelFor(ranked.size(), [&](int worker, size_t i)
+                         { best[i] = sweepAngles(ranked[i], mirrors, contexts[worker], counts[i]); });
+        for (long long count : counts)
+        {
+            evaluations += count;
+        }
+
+        size_t winner = 0;
+        for (size_t i = 1; i < best.size(); ++i)
+        {
+            if (best[i].score > best[winner].score)
+            {
+                winner = i;
+            }
+        }
+        if (options.report)
+        {
+            printf("Lamp search: %zu positions ranked, top %zu swept, best %.4f at (%.6f, %.6f) angle %.6f\n",
+                   positionCount, best.size(), best[winner].score, best[winner].lamp.v.x, best[winner].lamp.v.y,
+                   best[winner].lamp.angle);
+        }
+        return best[winner];
+    }
+
+    long long getEvaluations() const
+    {
+        return evaluations;
+    }
+
+private:
+    const Temple &temple;
+    ThreadPool &pool;
+    std::vector<ScoringContext> &contexts;
+    LampSearchOptions options;
+    std::vector<Vector2> corners;
+    size_t positionCount = 0;
+    long long evaluations = 0;
+
+    // Feasible grid positions, best heuristic first. Without mirrors, symmetric lamps cover
+    // the same, so only the fundamental domain is kept.
+    std::vector<LampCandidate> rankPositions(bool useSymmetry)
+    {
+        Symmetry symmetry(temple);
+        auto [sizeX, sizeY] = temple.getSize();
+        std::vector<LampCandidate> candidates;
+        for (double x = options.positionStep / 2; x < sizeX; x += options.positionStep)
+        {
+            for (double y = options.positionStep / 2; y < sizeY; y += options.positionStep)
+            {
+                Vector2 position(x, y);
+                if (Repair::lampFeasible(temple, position) && (!useSymmetry || symmetry.inFundamentalDomain(position)))
+                {
+                    candidates.push_back({Lamp(position, 0)});
+                }
+            }
+        }
+        BoundaryPoses boundary(temple);
+        for (int f = 0; f < (int)boundary.getFaces().size(); ++f)
+        {
+            double length = boundary.getFaces()[f].length;
+            for (double along = 0; along <= length; along += options.positionStep)
+            {
+                Vector2 position = boundary.facePoint(f, along / length);
+                if (Repair::lampFeasible(temple, position) && (!useSymmetry || symmetry.inFundamentalDomain(position)))
+                {
+                    candidates.push_back({Lamp(position, 0)});
+                }
+            }
+        }
+        positionCount = candidates.size();
+
+        pool.parallelFor(candidates.size(), [&](int, size_t i)
+                         { candidates[i].heuristic = longestChord(candidates[i].lamp.v); });
+        std::stable_sort(candidates.begin(), candidates.end(), [](const LampCandidate &a, const LampCandidate &b)
+                         { return a.heuristic > b.heuristic; });
+        return candidates;
+    }
+
+    double chord(const Vector2 &position, double angle) const
+    {
+        return Validation::temple_ray_intersection(temple, Ray(position, Vector2(std::cos(angle), std::sin(angle))));
+    }
+
+    // Length of the longest chord through the position, with the mean chord as a small tie-breaker
+    double longestChord(const Vector2 &position) const
+    {
+        double longest = 0, sum = 0;
+        for (int r = 0; r < options.rayCount; ++r)
+        {
+            double length = chord(position, 2 * M_PI * r / options.rayCount);
+            longest = std::max(longest, length);
+            sum += length;
+        }
+        return longest + 1e-3 * sum / options.rayCount;
+    }
+
+    // Score the critical and the uniform angles of one position; keeps the best
+    LampCandidate sweepAngles(const LampCandidate &candidate, const std::vector<Mirror> &mirrors, ScoringContext &context,
+                              long long &count) const
+    {
+        const Vector2 &position = candidate.lamp.v;
+        std::vector<double> angles;
+        for (const Vector2 &corner : corners)
+        {
+            Vector2 toCorner = corner - position;
+            double distance = toCorner.magnitude();
+            if (distance < 1e-9)
+            {
+                continue;
+            }
+            // The corner is an event if the ray gets there; blocks behind it don't matter
+            double angle = std::atan2(toCorner.y, toCorner.x);
+            double reach = std::max(chord(position, angle - options.eventOffset), chord(position, angle + options.eventOffset));
+            if (reach >= distance - 1e-6)
+            {
+                angles.push_back(angle - options.eventOffset);
+                angles.push_back(angle + options.eventOffset);
+            }
+        }
+        for (int a = 0; a < options.uniformAngles; ++a)
+        {
+            angles.push_back(2 * M_PI * a / options.uniformAngles);
+        }
+
+        LampCandidate best = candidate;
+        best.score = -1;
+        context.mirrors = mirrors;
+        for (double angle : angles)
+        {
+            context.lamp.updateLamp(position, angle < 0 ? angle + 2 * M_PI : angle);
+            double score = context.evaluate();
+            if (score > best.score)
+            {
+                best.score = score;
+                best.lamp = context.lamp;
+            }
+        }
+        count = angles.size();
+        return best;
+    }
+
+    // Grid points on the outline of the blocks: some but not all of the four cells around them blocked
+    std::vector<Vector2> blockCorners() const
+    {
+        auto [width, height] = temple.getShape();
+        double cell = temple.getBlockSize();
+        std::vector<Vector2> points;
+        for (int j = 0; j <= height; ++j)
+        {
+            for (int i = 0; i <= width; ++i)
+            {
+                int blocked = temple.isBlocked(i, j) + temple.isBlocked(i - 1, j) + temple.isBlocked(i, j - 1) +
+                              temple.isBlocked(i - 1, j - 1);
+                if (blocked > 0 && blocked < 4)
+                {
+                    points.push_back(Vector2(i * cell, j * cell));
+                }
+            }
+        }
+        return points;
+    }
+};
+
+#endif // LAMP_SEARCH_H
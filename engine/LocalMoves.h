@@ -0,0 +1,199 @@
+#ifndef LOCAL_MOVES_H
+#define LOCAL_MOVES_H
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "../math/Vector2.h"
+#include "Temple.h"
+#include "Lamp.h"
+#include "Mirror.h"
+#include "SolutionSpace.h"
+#include "Repair.h"
+#include "IncrementalEvaluator.h"
+
+// The move machinery of the local-move solvers (SimulatedAnnealing,
+// ParallelTempering). A move changes one coordinate of one element by a
+// gaussian step, is repaired if it makes the solution infeasible and is scored
+// incrementally; the caller then keeps or rejects it. Every coordinate has its
+// own step size, adapted towards a target acceptance rate.
+class LocalMoves
+{
+public:
+    LocalMoves(const Temple &temple, int pixelsPerUnit, double targetAcceptance, int adaptEvery)
+        : temple(temple), space(temple), evaluator(temple, pixelsPerUnit),
+          targetAcceptance(targetAcceptance), adaptEvery(adaptEvery)
+    {
+    }
+
+    // Start from a (feasible) solution; returns its score. Step sizes are kept.
+    double reset(const Lamp &lamp, const std::vector<Mirror> &mirrors)
+    {
+        trial = mirrors;
+        return evaluator.reset(lamp, mirrors);
+    }
+
+    // Every step back to 5% of its coordinate's range, with fresh acceptance counts
+    void resetSteps(int elements)
+    {
+        steps.assign(3 * elements, 0);
+        attempts.assign(3 * elements, 0);
+        accepts.assign(3 * elements, 0);
+        for (int d = 0; d < 3 * elements; ++d)
+        {
+            steps[d] = 0.05 * space.extent(d % 3);
+        }
+    }
+
+    int dimensions() const
+    {
+        return steps.size();
+    }
+
+    double score() const
+    {
+        return evaluator.score();
+    }
+
+    const Lamp &getLamp() const
+    {
+        return evaluator.getLamp();
+    }
+
+    const std::vector<Mirror> &getMirrors() const
+    {
+        return evaluator.getMirrors();
+    }
+
+    // Move coordinate d (element d / 3, coordinate d % 3) by a gaussian step and score the
+    // result. False if the move can't be repaired; then nothing changed.
+    bool propose(int d, std::mt19937_64 &rng, double &score)
+    {
+        int element = d / 3;
+        int coordinate = d % 3;
+        double step = steps[d] * std::normal_distribution<double>(0, 1)(rng);
+
+        if (element == 0)
+        {
+            Lamp lamp = evaluator.getLamp();
+            Vector2 position = lamp.v;
+            double angle = lamp.angle;
+            shift(coordinate, step, position, angle);
+            lamp.updateLamp(position, angle);
+            if (!Repair::repairLamp(temple, lamp))
+            {
+                return false;
+            }
+            score = evaluator.moveLamp(lamp.v, lamp.angle);
+            return true;
+        }
+
+        Mirror &mirror = trial[element - 1];
+        Vector2 position = mirror.v1;
+        double angle = mirror.angle;
+        shift(coordinate, step, position, angle);
+        mirror.updateMirror(position, angle);
+        if (!Repair::repairMirror(temple, trial, element - 1))
+        {
+            mirror = evaluator.getMirrors()[element - 1];
+            return false;
+        }
+        score = evaluator.moveMirror(element - 1, mirror.v1, mirror.angle);
+        return true;
+    }
+
+    // Undo the last proposed move of dimension d without counting it
+    void undo(int d)
+    {
+        evaluator.revert();
+        int element = d / 3;
+        if (element > 0)
+        {
+            trial[element - 1] = evaluator.getMirrors()[element - 1];
+        }
+    }
+
+    // Keep or undo the last proposed move of dimension d and adapt its step
+    void decide(int d, bool accepted)
+    {
+        if (accepted)
+        {
+            ++accepts[d];
+        }
+        else
+        {
+            undo(d);
+        }
+        ++attempts[d];
+        adaptStep(d);
+    }
+
+    // Count a move of dimension d that couldn't be proposed
+    void failed(int d)
+    {
+        ++attempts[d];
+        adaptStep(d);
+    }
+
+    // Exchange step sizes and acceptance counts, e.g. with the replica taking over this temperature
+    void swapSteps(LocalMoves &other)
+    {
+        steps.swap(other.steps);
+        attempts.swap(other.attempts);
+        accepts.swap(other.accepts);
+    }
+
+private:
+    const Temple &temple;
+    SolutionSpace space;
+    IncrementalEvaluator evaluator;
+    double targetAcceptance;
+    int adaptEvery;
+
+    std::vector<Mirror> trial;    // Mirrors for feasibility checks, in sync with the evaluator
+    std::vector<double> steps;    // Step size per (element, coordinate)
+    std::vector<long long> attempts;
+    std::vector<long long> accepts;
+
+    void shift(int coordinate, double step, Vector2 &position, double &angle) const
+    {
+        if (coordinate == 0)
+        {
+            position.x = std::min(std::max(position.x + step, space.lower(0)), space.upper(0));
+        }
+        else if (coordinate == 1)
+        {
+            position.y = std::min(std::max(position.y + step, space.lower(1)), space.upper(1));
+        }
+        else
+        {
+            angle = SolutionSpace::wrapAngle(angle + step);
+        }
+    }
+
+    // Widen the step of a dimension that accepts too often, narrow one that rarely does
+    void adaptStep(int d)
+    {
+        if (attempts[d] < adaptEvery)
+        {
+            return;
+        }
+        double rate = (double)accepts[d] / attempts[d];
+        double target = targetAcceptance;
+        if (rate > target)
+        {
+            steps[d] *= 1 + 2 * (rate - target) / (1 - target);
+        }
+        else
+        {
+            steps[d] /= 1 + 2 * (target - rate) / target;
+        }
+        double extent = space.extent(d % 3);
+        steps[d] = std::min(std::max(steps[d], 1e-6 * extent), 0.5 * extent);
+        attempts[d] = 0;
+        accepts[d] = 0;
+    }
+};
+
+#endif // LOCAL_MOVES_H
@@ -0,0 +1,57 @@
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. The producer only writes `tail` and the consumer only writes `head`;
+// each publishes its slot with a release store that the other side reads with
+// an acquire load, so neither ever waits on the other. A full mailbox refuses
+// the message instead of blocking.
+template <typename T>
+class Mailbox
+{
+public:
+    explicit Mailbox(size_t capacity) : slots(capacity + 1)
+    {
+    }
+
+    Mailbox(const Mailbox &) = delete;
+    Mailbox &operator=(const Mailbox &) = delete;
+
+    // Producer side; false if the mailbox is full
+    bool push(const T &message)
+    {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        const size_t next = (t + 1) % slots.size();
+        if (next == head.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        slots[t] = message;
+        tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side; false if the mailbox is empty
+    bool pop(T &message)
+    {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        message = std::move(slots[h]);
+        head.store((h + 1) % slots.size(), std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::vector<T> slots;
+    alignas(64) std::atomic<size_t> head{0}; // Next slot to read, written by the consumer
+    alignas(64) std::atomic<size_t> tail{0}; // Next slot to write, written by the producer
+};
+
+#endif // MAILBOX_H
@@ -22,8 +22,13 @@ public:
         updateMirror(v1, angle, mirror_length);
     }
 
+    // Method to move and rotate the mirror, keeping its length
+    void updateMirror(const Vector2& newPos, double newAngle) {
+        updateMirror(newPos, newAngle, mirror_length);
+    }
+
     // Method to update the mirror's properties
-    void updateMirror(const Vector2& newPos, double newAngle, double newLength = 0.5) {
+    void updateMirror(const Vector2& newPos, double newAngle, double newLength) {
         v1 = newPos;           // Update the start position
         angle = newAngle;       // Update the angle
         mirror_length = newLength;  // Update the length
@@ -0,0 +1,215 @@
+#ifndef MIRROR_BVH_H
+#define MIRROR_BVH_H
+
+#include "../math/Vector2.h"
+#include "Mirror.h"
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+// Bounding volume hierarchy over mirror segments, so finding the mirror a ray hits
+// first costs roughly O(log mirrors) instead of testing every mirror. The tree shape
+// is built once; when a single mirror moves, refit() only updates the boxes on the
+// path from its leaf to the root.
+class MirrorBVH {
+public:
+    MirrorBVH() = default;
+
+    explicit MirrorBVH(const std::vector<Mirror>& mirrors) {
+        build(mirrors);
+    }
+
+    // Build the tree by recursively splitting the mirrors at the median of the longer axis
+    void build(const std::vector<Mirror>& mirrors) {
+        nodes.clear();
+        order.resize(mirrors.size());
+        leafOf.assign(mirrors.size(), -1);
+        for (size_t i = 0; i < mirrors.size(); ++i) {
+            order[i] = i;
+        }
+        if (!mirrors.empty()) {
+            nodes.reserve(2 * mirrors.size());
+            buildNode(mirrors, 0, mirrors.size(), -1);
+        }
+    }
+
+    // Update the boxes after mirror `index` moved or rotated
+    void refit(const std::vector<Mirror>& mirrors, size_t index) {
+        if (mirrors.size() != leafOf.size()) {
+            build(mirrors);
+            return;
+        }
+        int node = leafOf[index];
+        if (node < 0) {
+            return;
+        }
+        fitLeaf(mirrors, nodes[node]);
+        for (node = nodes[node].parent; node >= 0; node = nodes[node].parent) {
+            fitInner(nodes[node]);
+        }
+    }
+
+    // Update all boxes, keeping the tree shape
+    void refitAll(const std::vector<Mirror>& mirrors) {
+        if (mirrors.size() != leafOf.size()) {
+            build(mirrors);
+            return;
+        }
+        // Children are always stored after their parent, so a reverse sweep is bottom-up
+        for (int i = (int)nodes.size() - 1; i >= 0; --i) {
+            if (nodes[i].count > 0) {
+                fitLeaf(mirrors, nodes[i]);
+            } else {
+                fitInner(nodes[i]);
+            }
+        }
+    }
+
+    size_t size() const {
+        return leafOf.size();
+    }
+
+    // Visit the mirrors whose boxes the ray enters before tBest. hitTest(index, tBest)
+    // may lower tBest, which prunes the rest of the traversal.
+    template <typename HitTest>
+    void traverse(const Vector2& origin, const Vector2& direction, double& tBest, HitTest hitTest) const {
+        if (nodes.empty()) {
+            return;
+        }
+
+        Vector2 inverse = {1.0 / direction.x, 1.0 / direction.y};
+        int stack[64];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            const Node& node = nodes[stack[--top]];
+            double tEnter = enterBox(node, origin, inverse);
+            // Equal distances are still visited, so ties go to the lower mirror index like in a linear scan
+            if (!(tEnter <= tBest)) {
+                continue;
+            }
+
+            if (node.count > 0) {
+                for (int k = node.first; k < node.first + node.count; ++k) {
+                    hitTest(order[k], tBest);
+                }
+                continue;
+            }
+
+            // Visit the nearer child first so tBest shrinks early
+            double tLeft = enterBox(nodes[node.left], origin, inverse);
+            double tRight = enterBox(nodes[node.right], origin, inverse);
+            if (tLeft <= tRight) {
+                stack[top++] = node.right;
+                stack[top++] = node.left;
+            } else {
+                stack[top++] = node.left;
+                stack[top++] = node.right;
+            }
+        }
+    }
+
+private:
+    struct Node {
+        Vector2 min, max;
+        int left = -1, right = -1;
+        int parent = -1;
+        int first = 0, count = 0; // Range in `order` for leaves, count == 0 for inner nodes
+    };
+
+    static constexpr int maxLeafSize = 2;
+
+    std::vector<Node> nodes;
+    std::vector<int> order;  // Mirror indices, grouped by leaf
+    std::vector<int> leafOf; // Leaf node of every mirror
+
+    int buildNode(const std::vector<Mirror>& mirrors, int first, int last, int parent) {
+        int index = nodes.size();
+        nodes.emplace_back();
+        nodes[index].parent = parent;
+
+        if (last - first <= maxLeafSize) {
+            nodes[index].first = first;
+            nodes[index].count = last - first;
+            for (int k = first; k < last; ++k) {
+                leafOf[order[k]] = index;
+            }
+            fitLeaf(mirrors, nodes[index]);
+            return index;
+        }
+
+        // Split along the longer axis of the mirror centers
+        Vector2 lo = center(mirrors[order[first]]);
+        Vector2 hi = lo;
+        for (int k = first + 1; k < last; ++k) {
+            Vector2 c = center(mirrors[order[k]]);
+            lo = {std::min(lo.x, c.x), std::min(lo.y, c.y)};
+            hi = {std::max(hi.x, c.x), std::max(hi.y, c.y)};
+        }
+        bool splitX = hi.x - lo.x >= hi.y - lo.y;
+        int middle = (first + last) / 2;
+        std::nth_element(order.begin() + first, order.begin() + middle, order.begin() + last,
+                         [&](int a, int b) {
+                             Vector2 ca = center(mirrors[a]);
+                             Vector2 cb = center(mirrors[b]);
+                             return splitX ? ca.x < cb.x : ca.y < cb.y;
+                         });
+
+        int left = buildNode(mirrors, first, middle, index);
+        int right = buildNode(mirrors, middle, last, index);
+        nodes[index].left = left;
+        nodes[index].right = right;
+        fitInner(nodes[index]);
+        return index;
+    }
+
+    static Vector2 center(const Mirror& mirror) {
+        return (mirror.v1 + mirror.v2) * 0.5;
+    }
+
+    void fitLeaf(const std::vector<Mirror>& mirrors, Node& node) const {
+        // The padding keeps hits computed by the intersection test inside the box despite rounding
+        const double pad = 1e-9;
+        node.min = {std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity()};
+        node.max = {-std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity()};
+        for (int k = node.first; k < node.first + node.count; ++k) {
+            const Mirror& mirror = mirrors[order[k]];
+            node.min = {std::min({node.min.x, mirror.v1.x - pad, mirror.v2.x - pad}),
+                        std::min({node.min.y, mirror.v1.y - pad, mirror.v2.y - pad})};
+            node.max = {std::max({node.max.x, mirror.v1.x + pad, mirror.v2.x + pad}),
+                        std::max({node.max.y, mirror.v1.y + pad, mirror.v2.y + pad})};
+        }
+    }
+
+    void fitInner(Node& node) const {
+        const Node& left = nodes[node.left];
+        const Node& right = nodes[node.right];
+        node.min = {std::min(left.min.x, right.min.x), std::min(left.min.y, right.min.y)};
+        node.max = {std::max(left.max.x, right.max.x), std::max(left.max.y, right.max.y)};
+    }
+
+    // Ray parameter where the ray enters the box (0 if it starts inside), or infinity if it misses
+    static double enterBox(const Node& node, const Vector2& origin, const Vector2& inverse) {
+        double tMin = 0;
+        double tMax = std::numeric_limits<double>::infinity();
+        if (!clipSlab(origin.x, inverse.x, node.min.x, node.max.x, tMin, tMax) ||
+            !clipSlab(origin.y, inverse.y, node.min.y, node.max.y, tMin, tMax)) {
+            return std::numeric_limits<double>::infinity();
+        }
+        return tMin;
+    }
+
+    static bool clipSlab(double origin, double inverse, double lo, double hi, double& tMin, double& tMax) {
+        if (std::isinf(inverse)) {
+            // The ray is parallel to the slab
+            return lo <= origin && origin <= hi;
+        }
+        double t1 = (lo - origin) * inverse;
+        double t2 = (hi - origin) * inverse;
+        tMin = std::max(tMin, std::min(t1, t2));
+        tMax = std::min(tMax, std::max(t1, t2));
+        return tMin <= tMax;
+    }
+};
+
+#endif // MIRROR_BVH_H
@@ -0,0 +1,223 @@
+#ifndef OCCUPANCY_PYRAMID_H
+#define OCCUPANCY_PYRAMID_H
+
+#include "../math/Vector2.h"
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+// Hierarchical occupancy over the temple grid, for temples far larger than the
+// competition one (1000x1000 and up).
+//
+// Rays: level 0 marks every cell that has a block in its 3x3 neighbourhood, and
+// each coarser level ORs 2x2 cells of the level below. A ray can only touch a
+// block while it is in a marked cell, so traverse() jumps over unmarked cells of
+// the coarsest possible level in one step and only tests blocks next to the ray.
+//
+// Coverage: per-row prefix counts of blocked cells give the number of vacant
+// cells in any run of a row in O(1), so long all-vacant or all-blocked stretches
+// under the beam are counted without visiting them.
+class OccupancyPyramid {
+public:
+    OccupancyPyramid() = default;
+
+    // blocked[j * width + i] != 0 for a block in column i, row j (row 0 at the bottom)
+    void build(const std::vector<unsigned char>& blocked, int width, int height, double blockSize) {
+        cellsX = width;
+        cellsY = height;
+        cellSize = blockSize;
+
+        // Row prefix counts
+        rowPrefix.assign((size_t)(width + 1) * height, 0);
+        for (int j = 0; j < height; ++j) {
+            int* prefix = &rowPrefix[(size_t)j * (width + 1)];
+            for (int i = 0; i < width; ++i) {
+                prefix[i + 1] = prefix[i] + (blocked[(size_t)j * width + i] != 0);
+            }
+        }
+
+        // Level 0 covers the grid plus a ring of outside cells, so rays leaving an open
+        // temple still see the outer sides of the border blocks
+        levels.clear();
+        Level base;
+        base.width = width + 2;
+        base.height = height + 2;
+        base.cells.assign((size_t)base.width * base.height, 0);
+        for (int j = 0; j < height; ++j) {
+            for (int i = 0; i < width; ++i) {
+                if (!blocked[(size_t)j * width + i]) {
+                    continue;
+                }
+                for (int dj = 0; dj <= 2; ++dj) {
+                    for (int di = 0; di <= 2; ++di) {
+                        base.cells[(size_t)(j + dj) * base.width + (i + di)] = 1;
+                    }
+                }
+            }
+        }
+        levels.push_back(base);
+
+        while (levels.back().width > 1 || levels.back().height > 1) {
+            const Level& fine = levels.back();
+            Level coarse;
+            coarse.width = (fine.width + 1) / 2;
+            coarse.height = (fine.height + 1) / 2;
+            coarse.cells.assign((size_t)coarse.width * coarse.height, 0);
+            for (int j = 0; j < fine.height; ++j) {
+                for (int i = 0; i < fine.width; ++i) {
+                    if (fine.cells[(size_t)j * fine.width + i]) {
+                        coarse.cells[(size_t)(j / 2) * coarse.width + (i / 2)] = 1;
+                    }
+                }
+            }
+            levels.push_back(coarse);
+        }
+    }
+
+    int levelCount() const {
+        return levels.size();
+    }
+
+    // Number of blocked cells among columns [i0, i1] of row j
+    int blockedInRow(int j, int i0, int i1) const {
+        if (j < 0 || j >= cellsY) {
+            return 0;
+        }
+        i0 = std::max(i0, 0);
+        i1 = std::min(i1, cellsX - 1);
+        if (i0 > i1) {
+            return 0;
+        }
+        const int* prefix = &rowPrefix[(size_t)j * (cellsX + 1)];
+        return prefix[i1 + 1] - prefix[i0];
+    }
+
+    bool isBlocked(int i, int j) const {
+        return blockedInRow(j, i, i) != 0;
+    }
+
+    // Walk the ray through the grid in order of distance. testCell(i, j, tBest) is called
+    // for every blocked cell that the ray may touch and may lower tBest; the walk stops as
+    // soon as nothing further along the ray can beat tBest.
+    template <typename CellTest>
+    void traverse(const Vector2& origin, const Vector2& direction, double& tBest, CellTest testCell) const {
+        if (levels.empty()) {
+            return;
+        }
+
+        // Traversal happens in level 0 coordinates: cell k covers [(k - 1) * cellSize, k * cellSize)
+        const Level& base = levels[0];
+        double ox = origin.x / cellSize + 1;
+        double oy = origin.y / cellSize + 1;
+        double dx = direction.x / cellSize;
+        double dy = direction.y / cellSize;
+
+        // Clip the ray to the extended grid
+        double t = 0;
+        double tEnd = std::numeric_limits<double>::infinity();
+        if (!clipSlab(ox, dx, base.width, t, tEnd) || !clipSlab(oy, dy, base.height, t, tEnd)) {
+            return;
+        }
+
+        int i = cellIndex(ox + t * dx, dx, base.width);
+        int j = cellIndex(oy + t * dy, dy, base.height);
+
+        while (i >= 0 && j >= 0 && i < base.width && j < base.height && t <= tBest) {
+            // The coarsest level at which the current cell is still empty
+            int level = -1;
+            while (level + 1 < (int)levels.size()) {
+                const Level& next = levels[level + 1];
+                int li = i >> (level + 1);
+                int lj = j >> (level + 1);
+                if (next.cells[(size_t)lj * next.width + li]) {
+                    break;
+                }
+                ++level;
+            }
+
+            if (level < 0) {
+                // A block is next to this cell, test all blocks around it
+                for (int nj = j - 1; nj <= j + 1; ++nj) {
+                    for (int ni = i - 1; ni <= i + 1; ++ni) {
+                        if (isBlocked(ni - 1, nj - 1)) {
+                            testCell(ni - 1, nj - 1, tBest);
+                        }
+                    }
+                }
+            }
+
+            // Leave the (possibly coarse) empty cell through the nearer side
+            int size = 1 << std::max(level, 0);
+            int boxX = (i >> std::max(level, 0)) * size;
+            int boxY = (j >> std::max(level, 0)) * size;
+            double tx = exitTime(ox, dx, boxX, size);
+            double ty = exitTime(oy, dy, boxY, size);
+            double tExit = std::min(tx, ty);
+            if (tBest <= tExit) {
+                return;
+            }
+
+            if (tx <= ty) {
+                i = dx > 0 ? boxX + size : boxX - 1;
+                j = std::min(std::max(cellIndex(oy + tExit * dy, dy, base.height), boxY), boxY + size - 1);
+                if (tx == ty) {
+                    // Exactly through a corner, step diagonally
+                    j = dy > 0 ? boxY + size : boxY - 1;
+                }
+            } else {
+                j = dy > 0 ? boxY + size : boxY - 1;
+                i = std::min(std::max(cellIndex(ox + tExit * dx, dx, base.width), boxX), boxX + size - 1);
+            }
+            t = tExit;
+        }
+    }
+
+private:
+    struct Level {
+        int width = 0;
+        int height = 0;
+        std::vector<unsigned char> cells;
+    };
+
+    int cellsX = 0;
+    int cellsY = 0;
+    double cellSize = 1;
+    std::vector<int> rowPrefix; // (cellsX + 1) counts per row
+    std::vector<Level> levels;
+
+    // Clip the ray parameter range to the slab [0, size] of one axis
+    static bool clipSlab(double origin, double direction, double size, double& tMin, double& tMax) {
+        if (direction == 0) {
+            return 0 <= origin && origin <= size;
+        }
+        double t1 = (0 - origin) / direction;
+        double t2 = (size - origin) / direction;
+        tMin = std::max(tMin, std::min(t1, t2));
+        tMax = std::min(tMax, std::max(t1, t2));
+        return tMin <= tMax;
+    }
+
+    // Cell containing the coordinate; on a cell edge, the cell the ray is moving into
+    static int cellIndex(double coordinate, double direction, int count) {
+        double f = std::floor(coordinate);
+        int k = static_cast<int>(f);
+        if (coordinate == f && direction < 0) {
+            --k;
+        }
+        return std::min(std::max(k, 0), count - 1);
+    }
+
+    // Ray parameter at which the ray leaves [box, box + size) along one axis
+    static double exitTime(double origin, double direction, int box, int size) {
+        if (direction > 0) {
+            return (box + size - origin) / direction;
+        }
+        if (direction < 0) {
+            return (box - origin) / direction;
+        }
+        return std::numeric_limits<double>::infinity();
+    }
+};
+
+#endif // OCCUPANCY_PYRAMID_H
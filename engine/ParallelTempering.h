@@ -0,0 +1,255 @@
+#ifndef PARALLEL_TEMPERING_H
+#define PARALLEL_TEMPERING_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+#include "Temple.h"
+#include "Lamp.h"
+#include "Mirror.h"
+#include "ThreadPool.h"
+#include "LocalMoves.h"
+
+struct TemperingOptions
+{
+    int replicas = 8;                  // Temperatures on the ladder, one replica each
+    double maxTemperature = 0;         // Hottest rung; 0 calibrates it from random moves as in SimulatedAnnealing
+    double minTemperature = 1e-3;      // Coldest rung; the rungs in between are spaced geometrically
+    int sweep = 1000;                  // Moves of every replica between two rounds of swaps
+    double seconds = 60;               // Wall-clock budget
+    long long maxRounds = -1;          // Also stop after this many rounds (< 0 for no limit)
+    double targetAcceptance = 0.4;     // Per-dimension acceptance rate the step sizes aim for
+    int adaptEvery = 100;              // Moves of one dimension between two step size adjustments
+    int reportEvery = 20;              // Progress line every this many rounds (0 for none)
+    unsigned long long seed = 1;       // Replica k uses seed + k + 1, the swaps seed itself
+};
+
+// Replica exchange Monte Carlo. Every replica is a Metropolis walk at a fixed
+// temperature on a geometric ladder, with the single-coordinate moves and
+// incremental scoring of SimulatedAnnealing (see LocalMoves). Hot replicas
+// wander across the infeasible gaps between the narrow optima, cold ones climb
+// the optimum they are in. Each round every replica makes `sweep` moves, the
+// replicas in parallel; then neighbouring rungs try to swap their states, even
+// pairs in even rounds and odd pairs in odd ones. A swap between temperatures
+// Ti < Tj with scores si, sj is accepted with probability
+//   min(1, exp((sj - si) * (1 / Ti - 1 / Tj))),
+// which keeps each rung at its own equilibrium; a better state always moves
+// down. Rungs exchange replicas rather than states, so nothing is rescored, and
+// the step sizes stay with their temperature.
+//
+// Every replica has its own random stream and the swaps are decided serially,
+// so runs are reproducible for a given seed with any number of threads.
+class ParallelTempering
+{
+public:
+    ParallelTempering(const Temple &temple, int pixelsPerUnit, ThreadPool &pool,
+                      const TemperingOptions &options = TemperingOptions())
+        : pool(pool), options(options), rng(options.seed)
+    {
+        const int count = std::max(2, options.replicas);
+        for (int k = 0; k < count; ++k)
+        {
+            replicas.push_back(std::make_unique<Replica>(temple, pixelsPerUnit, options, options.seed + k + 1));
+        }
+    }
+
+    // Temper from the given (feasible) solution, which every replica starts from. Returns
+    // the best score and leaves the best solution in lamp and mirrors.
+    double run(Lamp &lamp, std::vector<Mirror> &mirrors)
+    {
+        const int count = replicas.size();
+        for (std::unique_ptr<Replica> &replica : replicas)
+        {
+            replica->moves.resetSteps(mirrors.size() + 1);
+            replica->current = replica->moves.reset(lamp, mirrors);
+        }
+        best = replicas.front()->current;
+        bestLamp = lamp;
+        bestMirrors = mirrors;
+
+        double hottest = options.maxTemperature > 0 ? options.maxTemperature : calibrateTemperature();
+        double coldest = std::min(options.minTemperature, hottest);
+        temperatures.resize(count);
+        for (int k = 0; k < count; ++k)
+        {
+            temperatures[k] = coldest * std::pow(hottest / coldest, (double)k / (count - 1));
+        }
+        rungs.resize(count);
+        for (int k = 0; k < count; ++k)
+        {
+            rungs[k] = k;
+        }
+        swapAttempts.assign(count - 1, 0);
+        swapAccepts.assign(count - 1, 0);
+
+        auto start = std::chrono::steady_clock::now();
+        long long round = 0;
+        while (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < options.seconds &&
+               (options.maxRounds < 0 || round < options.maxRounds))
+        {
+            pool.parallelFor(count, [&](int, size_t k)
+                             { replicas[rungs[k]]->walk(temperatures[k], options.sweep); });
+            collectBest();
+            exchange(round % 2);
+            ++round;
+
+            if (options.reportEvery > 0 && round % options.reportEvery == 0)
+            {
+                printf("Round %lld: best = %.4f, coldest = %.4f, hottest = %.4f, swap acceptance = %.3f\n", round, best,
+                       replicas[rungs.front()]->current, replicas[rungs.back()]->current, overallSwapRate());
+            }
+        }
+
+        printf("Parallel tempering finished after %lld rounds: best = %.4f\n", round, best);
+        for (int k = 0; k + 1 < count; ++k)
+        {
+            printf("  Swap T = %.5f <-> %.5f: %lld / %lld accepted (%.3f)\n", temperatures[k], temperatures[k + 1],
+                   swapAccepts[k], swapAttempts[k], swapRate(k));
+        }
+        lamp = bestLamp;
+        mirrors = bestMirrors;
+        return best;
+    }
+
+    const std::vector<double> &getTemperatures() const
+    {
+        return temperatures;
+    }
+
+    // Fraction of accepted swaps between rungs k and k + 1
+    double swapRate(int k) const
+    {
+        return swapAttempts[k] > 0 ? (double)swapAccepts[k] / swapAttempts[k] : 0;
+    }
+
+private:
+    struct Replica
+    {
+        LocalMoves moves;
+        std::mt19937_64 rng;
+        double current = 0;
+        double best = 0;
+        Lamp bestLamp = Lamp({0, 0}, 0);
+        std::vector<Mirror> bestMirrors;
+
+        Replica(const Temple &temple, int pixelsPerUnit, const TemperingOptions &options, unsigned long long seed)
+            : moves(temple, pixelsPerUnit, options.targetAcceptance, options.adaptEvery), rng(seed)
+        {
+        }
+
+        // Metropolis moves at a fixed temperature, remembering the best state seen
+        void walk(double temperature, int count)
+        {
+            best = current;
+            for (int move = 0; move < count; ++move)
+            {
+                int d = std::uniform_int_distribution<int>(0, moves.dimensions() - 1)(rng);
+                double score;
+                if (!moves.propose(d, rng, score))
+                {
+                    moves.failed(d);
+                    continue;
+                }
+                double delta = score - current;
+                bool accept = delta >= 0 || std::uniform_real_distribution<double>(0, 1)(rng) < std::exp(delta / temperature);
+                if (accept)
+                {
+                    current = score;
+                }
+                moves.decide(d, accept);
+                if (current > best)
+                {
+                    best = current;
+                    bestLamp = moves.getLamp();
+                    bestMirrors = moves.getMirrors();
+                }
+            }
+        }
+    };
+
+    ThreadPool &pool;
+    TemperingOptions options;
+    std::mt19937_64 rng;
+    std::vector<std::unique_ptr<Replica>> replicas;
+    std::vector<double> temperatures;  // Rung k is at temperatures[k], coldest first
+    std::vector<int> rungs;            // Replica at each rung
+    std::vector<long long> swapAttempts;
+    std::vector<long long> swapAccepts;
+    double best = 0;
+    Lamp bestLamp = Lamp({0, 0}, 0);
+    std::vector<Mirror> bestMirrors;
+
+    void collectBest()
+    {
+        for (int k = 0; k < (int)rungs.size(); ++k)
+        {
+            const Replica &replica = *replicas[rungs[k]];
+            if (replica.best > best)
+            {
+                best = replica.best;
+                bestLamp = replica.bestLamp;
+                bestMirrors = replica.bestMirrors;
+            }
+        }
+    }
+
+    // Try to swap every pair (k, k + 1) with k of the given parity
+    void exchange(int parity)
+    {
+        for (int k = parity; k + 1 < (int)rungs.size(); k += 2)
+        {
+            Replica &cold = *replicas[rungs[k]];
+            Replica &hot = *replicas[rungs[k + 1]];
+            double exponent = (hot.current - cold.current) * (1 / temperatures[k] - 1 / temperatures[k + 1]);
+            ++swapAttempts[k];
+            if (exponent >= 0 || std::uniform_real_distribution<double>(0, 1)(rng) < std::exp(exponent))
+            {
+                cold.moves.swapSteps(hot.moves);
+                std::swap(rungs[k], rungs[k + 1]);
+                ++swapAccepts[k];
+            }
+        }
+    }
+
+    double overallSwapRate() const
+    {
+        long long attempts = 0, accepts = 0;
+        for (size_t k = 0; k < swapAttempts.size(); ++k)
+        {
+            attempts += swapAttempts[k];
+            accepts += swapAccepts[k];
+        }
+        return attempts > 0 ? (double)accepts / attempts : 0;
+    }
+
+    // Temperature at which an average worsening move is accepted half of the time
+    double calibrateTemperature()
+    {
+        Replica &replica = *replicas.front();
+        double worsening = 0;
+        int count = 0;
+        for (int k = 0; k < 200; ++k)
+        {
+            int d = std::uniform_int_distribution<int>(0, replica.moves.dimensions() - 1)(rng);
+            double before = replica.moves.score();
+            double score;
+            if (!replica.moves.propose(d, rng, score))
+            {
+                continue;
+            }
+            if (score < before)
+            {
+                worsening += before - score;
+                ++count;
+            }
+            replica.moves.undo(d);
+        }
+        return count > 0 ? worsening / count / std::log(2.0) : 1.0;
+    }
+};
+
+#endif // PARALLEL_TEMPERING_H
@@ -0,0 +1,343 @@
+#ifndef POLISHER_H
+#define POLISHER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+#include <vector>
+#include "../math/Vector2.h"
+#include "Temple.h"
+#include "Lamp.h"
+#include "Mirror.h"
+#include "Validation.h"
+#include "SolutionSpace.h"
+#include "ScoringContext.h"
+#include "IncrementalEvaluator.h"
+#include "Repair.h"
+
+struct PolishOptions
+{
+    int pixelsPerUnit = 150;          // Scoring resolution; polishing is worth doing at the finest one
+    double seconds = 60;              // Wall-clock budget of polish()
+    double positionStep = 0.01;       // Initial coordinate descent steps
+    double angleStep = 0.002;
+    double minStep = 1e-7;            // A coordinate is converged once its step falls below this
+    double simplexPosition = 0.005;   // Initial Nelder-Mead simplex offsets
+    double simplexAngle = 0.001;
+    int simplexIterations = 3000;     // Nelder-Mead iterations per pass
+    bool report = true;
+};
+
+// Local polishing of a finished solution at high scoring resolution. Cyclic
+// coordinate descent tries every coordinate of the lamp and each mirror in turn
+// with its own step, which grows after a success and shrinks after a failure;
+// moves are scored incrementally. A Nelder-Mead pass over all coordinates
+// then looks for gains that need several coordinates to move together. The two
+// alternate until neither gains or the budget is spent.
+//
+// Every candidate that would break check_solution is rejected, not repaired, so
+// the solution stays valid throughout and the score never decreases.
+class Polisher
+{
+public:
+    Polisher(const Temple &temple, const PolishOptions &options = PolishOptions())
+        : temple(temple), space(temple), evaluator(temple, options.pixelsPerUnit),
+          context(temple, options.pixelsPerUnit), options(options)
+    {
+    }
+
+    // Polish a valid solution in place; returns its final score
+    double polish(Lamp &lamp, std::vector<Mirror> &mirrors)
+    {
+        start = std::chrono::steady_clock::now();
+        double score = evaluator.reset(lamp, mirrors);
+        const double initial = score;
+        if (options.report)
+        {
+            printf("Polishing from %.5f at %d px/unit\n", score, options.pixelsPerUnit);
+        }
+
+        for (int pass = 1; !timeUp(); ++pass)
+        {
+            double before = score;
+            score = coordinateDescent(lamp, mirrors, score);
+            double afterDescent = score;
+            if (!timeUp())
+            {
+                score = nelderMead(lamp, mirrors, score);
+            }
+            if (options.report)
+            {
+                printf("Pass %d: coordinate descent %+.5f, Nelder-Mead %+.5f, score %.5f\n",
+                       pass, afterDescent - before, score - afterDescent, score);
+            }
+            if (score <= before)
+            {
+                break;
+            }
+        }
+
+        if (options.report)
+        {
+            printf("Polished %.5f -> %.5f (%+.5f)\n", initial, score, score - initial);
+        }
+        return score;
+    }
+
+private:
+    const Temple &temple;
+    SolutionSpace space;
+    IncrementalEvaluator evaluator;
+    ScoringContext context;
+    PolishOptions options;
+    std::chrono::steady_clock::time_point start;
+
+    bool timeUp() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= options.seconds;
+    }
+
+    // Sweeps over all coordinates until every step is below minStep
+    double coordinateDescent(Lamp &lamp, std::vector<Mirror> &mirrors, double score)
+    {
+        evaluator.reset(lamp, mirrors);
+        const int dimensions = 3 * (mirrors.size() + 1);
+        std::vector<double> steps(dimensions);
+        for (int d = 0; d < dimensions; ++d)
+        {
+            steps[d] = SolutionSpace::isAngle(d) ? options.angleStep : options.positionStep;
+        }
+
+        for (int sweep = 1; !timeUp(); ++sweep)
+        {
+            double before = score;
+            bool active = false;
+            for (int d = 0; d < dimensions && !timeUp(); ++d)
+            {
+                if (steps[d] < options.minStep)
+                {
+                    continue;
+                }
+                active = true;
+                if (tryMove(d, steps[d], mirrors, score) || tryMove(d, -steps[d], mirrors, score))
+                {
+                    steps[d] *= 2;
+                }
+                else
+                {
+                    steps[d] /= 2;
+                }
+            }
+            if (options.report && score > before)
+            {
+                printf("  Coordinate descent sweep %d: %.5f (%+.5f)\n", sweep, score, score - before);
+            }
+            if (!active)
+            {
+                break;
+            }
+        }
+
+        lamp = evaluator.getLamp();
+        mirrors = evaluator.getMirrors();
+        return score;
+    }
+
+    // Move coordinate d by step if the result is valid and scores strictly better
+    bool tryMove(int d, double step, std::vector<Mirror> &trial, double &score)
+    {
+        int element = d / 3;
+        Vector2 position = element == 0 ? evaluator.getLamp().v : evaluator.getMirrors()[element - 1].v1;
+        double angle = element == 0 ? evaluator.getLamp().angle : evaluator.getMirrors()[element - 1].angle;
+        if (d % 3 == 0)
+        {
+            position.x += step;
+        }
+        else if (d % 3 == 1)
+        {
+            position.y += step;
+        }
+        else
+        {
+            angle = SolutionSpace::wrapAngle(angle + step);
+        }
+
+        double moved;
+        if (element == 0)
+        {
+            if (!Repair::lampFeasible(temple, position))
+            {
+                return false;
+            }
+            moved = evaluator.moveLamp(position, angle);
+        }
+        else
+        {
+            size_t index = element - 1;
+            trial = evaluator.getMirrors();
+            trial[index].updateMirror(position, angle);
+            if (!mirrorValid(trial, index))
+            {
+                return false;
+            }
+            moved = evaluator.moveMirror(index, position, angle);
+        }
+
+        if (moved > score)
+        {
+            score = moved;
+            return true;
+        }
+        evaluator.revert();
+        return false;
+    }
+
+    // check_solution's tests for one mirror
+    bool mirrorValid(const std::vector<Mirror> &mirrors, size_t index) const
+    {
+        const Mirror &mirror = mirrors[index];
+        if (!Repair::mirrorFeasible(temple, mirror))
+        {
+            return false;
+        }
+        for (size_t i = 0; i < mirrors.size(); ++i)
+        {
+            if (i != index && Validation::segment_segment_intersection(mirror.s, mirrors[i].s))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Score of an encoded solution, -1 if it isn't valid
+    double evaluate(const std::vector<double> &x)
+    {
+        std::vector<double> normalized = x;
+        space.normalize(normalized);
+        space.decode(normalized, context.lamp, context.mirrors);
+        if (!Validation::check_solution(temple, context.lamp, context.mirrors, false))
+        {
+            return -1;
+        }
+        return context.evaluate();
+    }
+
+    // Nelder-Mead with the dimension-dependent coefficients of Gao and Han, which keep
+    // the simplex from collapsing in high dimensions. Invalid vertices score -1, so
+    // the simplex only ever accepts valid points.
+    double nelderMead(Lamp &lamp, std::vector<Mirror> &mirrors, double score)
+    {
+        const int n = space.dimensions();
+        const double alpha = 1, beta = 1 + 2.0 / n, gamma = 0.75 - 1.0 / (2 * n), delta = 1 - 1.0 / n;
+
+        std::vector<std::vector<double>> simplex(n + 1, space.encode(lamp, mirrors));
+        std::vector<double> values(n + 1, score);
+        for (int d = 0; d < n; ++d)
+        {
+            double offset = SolutionSpace::isAngle(d) ? options.simplexAngle : options.simplexPosition;
+            simplex[d + 1][d] += offset;
+            values[d + 1] = evaluate(simplex[d + 1]);
+            if (values[d + 1] < 0)
+            {
+                simplex[d + 1][d] -= 2 * offset; // Try the other side of a constraint
+                values[d + 1] = evaluate(simplex[d + 1]);
+            }
+        }
+
+        std::vector<int> order(n + 1);
+        std::vector<double> centroid(n), reflected(n), expanded(n), contracted(n);
+        for (int iteration = 0; iteration < options.simplexIterations && !timeUp(); ++iteration)
+        {
+            // Best first
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(), [&](int a, int b)
+                             { return values[a] > values[b]; });
+            const int best = order[0], worst = order[n], secondWorst = order[n - 1];
+
+            std::fill(centroid.begin(), centroid.end(), 0);
+            for (int i = 0; i < n; ++i)
+            {
+                for (int d = 0; d < n; ++d)
+                {
+                    centroid[d] += simplex[order[i]][d] / n;
+                }
+            }
+
+            for (int d = 0; d < n; ++d)
+            {
+                reflected[d] = centroid[d] + alpha * (centroid[d] - simplex[worst][d]);
+            }
+            double reflectedValue = evaluate(reflected);
+
+            if (reflectedValue > values[best])
+            {
+                for (int d = 0; d < n; ++d)
+                {
+                    expanded[d] = centroid[d] + beta * (reflected[d] - centroid[d]);
+                }
+                double expandedValue = evaluate(expanded);
+                if (expandedValue > reflectedValue)
+                {
+                    simplex[worst] = expanded;
+                    values[worst] = expandedValue;
+                }
+                else
+                {
+                    simplex[worst] = reflected;
+                    values[worst] = reflectedValue;
+                }
+                continue;
+            }
+            if (reflectedValue > values[secondWorst])
+            {
+                simplex[worst] = reflected;
+                values[worst] = reflectedValue;
+                continue;
+            }
+
+            // Contract towards the better of the worst and the reflected point
+            bool outside = reflectedValue > values[worst];
+            const std::vector<double> &towards = outside ? reflected : simplex[worst];
+            for (int d = 0; d < n; ++d)
+            {
+                contracted[d] = centroid[d] + gamma * (towards[d] - centroid[d]);
+            }
+            double contractedValue = evaluate(contracted);
+            if (contractedValue > std::max(values[worst], outside ? reflectedValue : -1.0))
+            {
+                simplex[worst] = contracted;
+                values[worst] = contractedValue;
+                continue;
+            }
+
+            // Shrink towards the best vertex
+            for (int i = 0; i <= n; ++i)
+            {
+                if (i == best)
+                {
+                    continue;
+                }
+                for (int d = 0; d < n; ++d)
+                {
+                    simplex[i][d] = simplex[best][d] + delta * (simplex[i][d] - simplex[best][d]);
+                }
+                values[i] = evaluate(simplex[i]);
+            }
+        }
+
+        int best = std::max_element(values.begin(), values.end()) - values.begin();
+        if (values[best] > score)
+        {
+            std::vector<double> x = simplex[best];
+            space.normalize(x);
+            space.decode(x, lamp, mirrors);
+            score = values[best];
+        }
+        return score;
+    }
+};
+
+#endif // POLISHER_H
@@ -0,0 +1,116 @@
+#ifndef PROBLEM_SPEC_H
+#define PROBLEM_SPEC_H
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+// The official CMC24 temple layout ('O' = block, '.' = vacant, top row first)
+inline constexpr char cmc24TempleString[] =
+    "O  O  O  O  O  O  O  O  O  O  O  O  O  O  O  O  O  O  O  O\n"
+    "O  .  .  .  .  O  .  .  .  .  .  .  .  .  O  .  .  .  .  O\n"
+    "O  .  .  .  .  .  .  .  O  .  .  O  .  .  .  .  .  .  .  O\n"
+    "O  .  .  .  .  .  O  .  .  .  .  .  .  O  .  .  .  .  .  O\n"
+    "O  .  .  O  .  .  .  .  .  O  O  .  .  .  .  .  O  .  .  O\n"
+    "O  O  .  .  .  .  .  .  .  O  O  .  .  .  .  .  .  .  O  O\n"
+    "O  .  .  .  O  .  .  .  .  .  .  .  .  .  .  O  .  .  .  O\n"
+    "O  .  .  .  .  .  .  O  .  .  .  .  O  .  .  .  .  .  .  O\n"
+    "O  .  .  .  .  .  .  .  .  O  O  .  .  .  .  .  .  .  .  O\n"
+    "O  .  O  .  .  O  O  .  .  .  .  .  .  O  O  .  .  O  .  O\n"
+    "O  .  O  .  .  O  O  .  .  .  .  .  .  O  O  .  .  O  .  O\n"
+    "O  .  .  .  .  .  .  .  .  O  O  .  .  .  .  .  .  .  .  O\n"
+    "O  .  .  .  .  .  .  O  .  .  .  .  O  .  .  .  .  .  .  O\n"
+    "O  .  .  .  O  .  .  .  .  .  .  .  .  .  .  O  .  .  .  O\n"
+    "O  O  .  .  .  .  .  .  .  O  O  .  .  .  .  .  .  .  O  O\n"
+    "O  .  .  O  .  .  .  .  .  O  O  .  .  .  .  .  O  .  .  O\n"
+    "O  .  .  .  .  .  O  .  .  .  .  .  .  O  .  .  .  .  .  O\n"
+    "O  .  .  .  .  .  .  .  O  .  .  O  .  .  .  .  .  .  .  O\n"
+    "O  .  .  .  .  O  .  .  .  .  .  .  .  .  O  .  .  .  .  O\n"
+    "O  O  O  O  O  O  O  O  O  O  O  O  O  O  O  O  O  O  O  O";
+
+// Everything that defines a CMC24-style problem instance. The defaults are the
+// official competition values, so a default constructed spec is the CMC24 problem.
+struct ProblemSpec {
+    std::string temple_string = cmc24TempleString;
+    int block_size = 1;
+    int mirror_count = 8;
+    double mirror_length = 0.5;
+    double beam_half_width = 1.0;
+
+    // Read a temple layout ('O' = block, '.' = vacant, spaces ignored) from a text file
+    static bool loadTempleFile(const std::string& filename, std::string& layout) {
+        std::ifstream file(filename);
+        if (!file) {
+            std::cerr << "ERROR! Can't open temple file " << filename << "." << std::endl;
+            return false;
+        }
+
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        layout = buffer.str();
+        return true;
+    }
+
+    // Load a problem spec from a "key value" text file. Missing keys keep their
+    // CMC24 defaults, lines starting with '#' are comments. Recognized keys:
+    //   temple_file      path to the layout (relative to the spec file)
+    //   block_size       side of one temple block
+    //   mirror_count     number of mirrors in a solution
+    //   mirror_length    length of every mirror
+    //   beam_half_width  half-width of the light beam
+    static bool loadFromFile(const std::string& filename, ProblemSpec& spec) {
+        std::ifstream file(filename);
+        if (!file) {
+            std::cerr << "ERROR! Can't open problem spec " << filename << "." << std::endl;
+            return false;
+        }
+
+        std::string directory;
+        size_t slash = filename.find_last_of("/\\");
+        if (slash != std::string::npos) {
+            directory = filename.substr(0, slash + 1);
+        }
+
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(file, line)) {
+            ++lineNumber;
+            std::istringstream tokens(line);
+            std::string key;
+            if (!(tokens >> key) || key[0] == '#') {
+                continue;
+            }
+
+            bool ok = true;
+            if (key == "temple_file") {
+                std::string templeFile;
+                ok = static_cast<bool>(tokens >> templeFile);
+                if (ok && !loadTempleFile(directory + templeFile, spec.temple_string)) {
+                    return false;
+                }
+            } else if (key == "block_size") {
+                ok = static_cast<bool>(tokens >> spec.block_size) && spec.block_size > 0;
+            } else if (key == "mirror_count") {
+                ok = static_cast<bool>(tokens >> spec.mirror_count) && spec.mirror_count >= 0;
+            } else if (key == "mirror_length") {
+                ok = static_cast<bool>(tokens >> spec.mirror_length) && spec.mirror_length > 0;
+            } else if (key == "beam_half_width") {
+                ok = static_cast<bool>(tokens >> spec.beam_half_width) && spec.beam_half_width > 0;
+            } else {
+                std::cerr << "ERROR! Unknown key '" << key << "' in " << filename << ":" << lineNumber << "." << std::endl;
+                return false;
+            }
+
+            if (!ok) {
+                std::cerr << "ERROR! Bad value for '" << key << "' in " << filename << ":" << lineNumber << "." << std::endl;
+                return false;
+            }
+        }
+
+        std::cerr << "The problem spec " << filename << " is loaded." << std::endl;
+        return true;
+    }
+};
+
+#endif // PROBLEM_SPEC_H
@@ -0,0 +1,208 @@
+#ifndef REPAIR_H
+#define REPAIR_H
+
+#include "../math/Vector2.h"
+#include "Temple.h"
+#include "Lamp.h"
+#include "Mirror.h"
+#include "Validation.h"
+#include "SolutionSpace.h"
+#include <vector>
+#include <cmath>
+#include <utility>
+#include <algorithm>
+
+// Feasibility repair for optimizer candidates. An infeasible pose is moved to the
+// nearest feasible one on a fine offset lattice, keeping all angles: first the
+// lamp and every mirror are slid out of blocks and into the temple, then mirrors
+// crossing an earlier mirror are nudged away from it. Feasible poses are left
+// untouched, so repairing a valid solution is a no-op.
+class Repair {
+public:
+    // Offset lattice step and the farthest a pose is moved, in block sizes
+    static constexpr double stepBlocks = 1.0 / 32;
+    static constexpr int maxSteps = 64;
+
+    static bool inBounds(const Temple& temple, const Vector2& point) {
+        return point.x >= 0 && point.y >= 0 && point.x <= temple.getSize().first && point.y <= temple.getSize().second;
+    }
+
+    static bool lampFeasible(const Temple& temple, const Vector2& position) {
+        return inBounds(temple, position) && !Validation::pointInBlock(temple, position);
+    }
+
+    // Same tests as check_solution for a single mirror against the temple
+    static bool mirrorFeasible(const Temple& temple, const Mirror& mirror) {
+        if (!inBounds(temple, mirror.v1) || !inBounds(temple, mirror.v2)) {
+            return false;
+        }
+        if (boxClearOfBlocks(temple, mirror.v1, mirror.v2)) {
+            return true;
+        }
+        return !Validation::pointInBlock(temple, mirror.v1) && !Validation::pointInBlock(temple, mirror.v2) &&
+               !Validation::temple_segment_intersection(temple, mirror.s);
+    }
+
+    // True if the mirror crosses any of the first `count` mirrors
+    static bool crossesAny(const Mirror& mirror, const std::vector<Mirror>& mirrors, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            if (Validation::segment_segment_intersection(mirror.s, mirrors[i].s)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool repairLamp(const Temple& temple, Lamp& lamp) {
+        Vector2 position = clampPoint(temple, lamp.v);
+        Vector2 repaired;
+        if (!nearestFeasible(temple, position, repaired, [&](const Vector2& p) {
+                return lampFeasible(temple, p);
+            })) {
+            return false;
+        }
+        if (!(repaired == lamp.v)) {
+            lamp.updateLamp(repaired, lamp.angle);
+        }
+        return true;
+    }
+
+    static bool repairMirrors(const Temple& temple, std::vector<Mirror>& mirrors) {
+        bool feasible = true;
+
+        // Out of blocks and into the temple
+        for (Mirror& mirror : mirrors) {
+            feasible &= moveMirror(temple, mirror, [&](const Mirror& m) {
+                return mirrorFeasible(temple, m);
+            });
+        }
+
+        // Apart from the mirrors before it
+        for (size_t i = 1; i < mirrors.size(); ++i) {
+            if (!crossesAny(mirrors[i], mirrors, i)) {
+                continue;
+            }
+            feasible &= moveMirror(temple, mirrors[i], [&](const Mirror& m) {
+                return mirrorFeasible(temple, m) && !crossesAny(m, mirrors, i);
+            });
+        }
+        return feasible;
+    }
+
+    // Move mirror `index` to the nearest pose clear of the temple and of every other mirror,
+    // for optimizers that change one mirror at a time
+    static bool repairMirror(const Temple& temple, std::vector<Mirror>& mirrors, size_t index) {
+        return moveMirror(temple, mirrors[index], [&](const Mirror& m) {
+            if (!mirrorFeasible(temple, m)) {
+                return false;
+            }
+            for (size_t i = 0; i < mirrors.size(); ++i) {
+                if (i != index && Validation::segment_segment_intersection(m.s, mirrors[i].s)) {
+                    return false;
+                }
+            }
+            return true;
+        });
+    }
+
+    // Repair the whole solution, true if the result passes check_solution
+    static bool repair(const Temple& temple, Lamp& lamp, std::vector<Mirror>& mirrors) {
+        bool lampOk = repairLamp(temple, lamp);
+        bool mirrorsOk = repairMirrors(temple, mirrors);
+        return lampOk && mirrorsOk;
+    }
+
+    // Repair an encoded solution in place, using lamp and mirrors as scratch
+    static bool repair(const Temple& temple, const SolutionSpace& space, std::vector<double>& x, Lamp& lamp, std::vector<Mirror>& mirrors) {
+        space.decode(x, lamp, mirrors);
+        bool feasible = repair(temple, lamp, mirrors);
+        x = space.encode(lamp, mirrors);
+        return feasible;
+    }
+
+private:
+    // True if no block touches the closed bounding box of a and b. Every wall is a side
+    // of a block, so such a segment can't touch a wall.
+    static bool boxClearOfBlocks(const Temple& temple, const Vector2& a, const Vector2& b) {
+        const double size = temple.getBlockSize();
+        int i0 = (int)std::ceil(std::min(a.x, b.x) / size) - 1;
+        int i1 = (int)std::floor(std::max(a.x, b.x) / size);
+        int j0 = (int)std::ceil(std::min(a.y, b.y) / size) - 1;
+        int j1 = (int)std::floor(std::max(a.y, b.y) / size);
+        for (int j = j0; j <= j1; ++j) {
+            if (temple.getPyramid().blockedInRow(j, i0, i1) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static Vector2 clampPoint(const Temple& temple, const Vector2& point) {
+        return {std::min(std::max(point.x, 0.0), (double)temple.getSize().first),
+                std::min(std::max(point.y, 0.0), (double)temple.getSize().second)};
+    }
+
+    // Lattice offsets within maxSteps, nearest first (ties in a fixed order)
+    static const std::vector<std::pair<int, int>>& offsets() {
+        static const std::vector<std::pair<int, int>> sorted = [] {
+            std::vector<std::pair<int, int>> list;
+            for (int dy = -maxSteps; dy <= maxSteps; ++dy) {
+                for (int dx = -maxSteps; dx <= maxSteps; ++dx) {
+                    if (dx * dx + dy * dy <= maxSteps * maxSteps) {
+                        list.push_back({dx, dy});
+                    }
+                }
+            }
+            std::stable_sort(list.begin(), list.end(), [](const std::pair<int, int>& a, const std::pair<int, int>& b) {
+                return a.first * a.first + a.second * a.second < b.first * b.first + b.second * b.second;
+            });
+            return list;
+        }();
+        return sorted;
+    }
+
+    // Nearest point start + offset * step for which feasible(point) holds
+    template <typename Feasible>
+    static bool nearestFeasible(const Temple& temple, const Vector2& start, Vector2& result, Feasible feasible) {
+        const double step = stepBlocks * temple.getBlockSize();
+        for (const auto& offset : offsets()) {
+            Vector2 candidate = start + Vector2(offset.first * step, offset.second * step);
+            if (feasible(candidate)) {
+                result = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Translate the mirror to the nearest pose passing `feasible`, keeping its angle
+    template <typename Feasible>
+    static bool moveMirror(const Temple& temple, Mirror& mirror, Feasible feasible) {
+        if (feasible(mirror)) {
+            return true;
+        }
+
+        // Shift both ends inside the temple first
+        Vector2 shift(0, 0);
+        double minX = std::min(mirror.v1.x, mirror.v2.x), maxX = std::max(mirror.v1.x, mirror.v2.x);
+        double minY = std::min(mirror.v1.y, mirror.v2.y), maxY = std::max(mirror.v1.y, mirror.v2.y);
+        shift.x = std::max(0.0, -minX) - std::max(0.0, maxX - temple.getSize().first);
+        shift.y = std::max(0.0, -minY) - std::max(0.0, maxY - temple.getSize().second);
+
+        // Candidates only move, so v2 and the segment tuple are updated without any trigonometry
+        Mirror candidate = mirror;
+        Vector2 start;
+        if (!nearestFeasible(temple, mirror.v1 + shift, start, [&](const Vector2& p) {
+                candidate.v1 = p;
+                candidate.v2 = p + mirror.direction * mirror.mirror_length;
+                std::get<0>(candidate.s) = p;
+                return feasible(candidate);
+            })) {
+            return false;
+        }
+        mirror.updateMirror(start, mirror.angle);
+        return true;
+    }
+};
+
+#endif // REPAIR_H
@@ -0,0 +1,232 @@
+#ifndef SCORER_H
+#define SCORER_H
+
+#include "../math/Vector2.h"
+#include "Temple.h"
+#include "Validation.h"
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+// CPU version of the official scoring: the temple is sampled on a pixel grid
+// (pixelsPerUnit pixels per world unit) and a vacant pixel is illuminated when its
+// center lies within beam_half_width of some path segment, i.e. inside one of the
+// rectangles + circles drawn by the official plot.
+//
+// Each segment is rasterized into one span per pixel row, the spans of a row are
+// merged, and the vacant pixels of a merged span are counted from the row prefix
+// counts of the occupancy pyramid. The cost depends on the number of rows under
+// the beam, not on the pixel area, and memory is O(cells), so 1000x1000 temples
+// can be scored at full resolution.
+class Scorer {
+public:
+    Scorer(const Temple& temple, int pixelsPerUnit = 20)
+        : occupancy(&temple.getPyramid()),
+          resolution(std::max(1, pixelsPerUnit)),
+          halfWidth(temple.getSpec().beam_half_width) {
+        pixelsPerCell = resolution * temple.getBlockSize();
+        auto shape = temple.getShape();
+        width = shape.first * pixelsPerCell;
+        height = shape.second * pixelsPerCell;
+
+        long long blockedCells = 0;
+        for (int j = 0; j < shape.second; ++j) {
+            blockedCells += occupancy->blockedInRow(j, 0, shape.first - 1);
+        }
+        vacantCount = ((long long)shape.first * shape.second - blockedCells) * pixelsPerCell * pixelsPerCell;
+        rowSpans.resize(height);
+    }
+
+    // Percentage of vacant pixels illuminated by the path
+    double evaluatePath(const Path& path) {
+        illuminatedCount = 0;
+        if (path.points.empty() || vacantCount == 0) {
+            return 0;
+        }
+
+        if (path.points.size() == 1) {
+            drawCapsule(path.points[0], path.points[0]);
+        }
+        for (size_t i = 0; i + 1 < path.points.size(); ++i) {
+            drawCapsule(path.points[i], path.points[i + 1]);
+        }
+
+        for (int py : touchedRows) {
+            illuminatedCount += countRow(py);
+        }
+        touchedRows.clear();
+
+        return 100.0 * (double)illuminatedCount / (double)vacantCount;
+    }
+
+    long long getIlluminatedCount() const {
+        return illuminatedCount;
+    }
+
+    long long getVacantCount() const {
+        return vacantCount;
+    }
+
+    int getResolution() const {
+        return resolution;
+    }
+
+    // Building blocks for incremental scoring (see IncrementalScorer)
+
+    // Call emit(py, colBegin, colEnd) for every pixel row covered by the capsule around [a, b]
+    template <typename Emit>
+    void forEachCapsuleRow(const Vector2& a, const Vector2& b, Emit emit) const {
+        if (!std::isfinite(a.x) || !std::isfinite(a.y) || !std::isfinite(b.x) || !std::isfinite(b.y)) {
+            return;
+        }
+
+        Vector2 d = b - a;
+        double length = d.magnitude();
+        if (length > 0) {
+            d = d * (1.0 / length);
+        }
+        Vector2 n = {-d.y, d.x};
+
+        double yMin = std::min(a.y, b.y) - halfWidth;
+        double yMax = std::max(a.y, b.y) + halfWidth;
+        int rowBegin = std::max(0, (int)std::ceil(yMin * resolution - 0.5));
+        int rowEnd = std::min(height - 1, (int)std::floor(yMax * resolution - 0.5));
+
+        for (int py = rowBegin; py <= rowEnd; ++py) {
+            double y = (py + 0.5) / resolution;
+            double lo = std::numeric_limits<double>::infinity();
+            double hi = -std::numeric_limits<double>::infinity();
+
+            // The rectangle swept along the segment
+            if (length > 0) {
+                double rlo = -std::numeric_limits<double>::infinity();
+                double rhi = std::numeric_limits<double>::infinity();
+                clipLinear(d.x, (y - a.y) * d.y - a.x * d.x, 0, length, rlo, rhi);
+                clipLinear(n.x, (y - a.y) * n.y - a.x * n.x, -halfWidth, halfWidth, rlo, rhi);
+                if (rlo <= rhi) {
+                    lo = rlo;
+                    hi = rhi;
+                }
+            }
+
+            // The circles at both ends
+            addCircle(a, y, lo, hi);
+            addCircle(b, y, lo, hi);
+            if (lo > hi) {
+                continue;
+            }
+
+            int colBegin = std::max(0, (int)std::ceil(lo * resolution - 0.5));
+            int colEnd = std::min(width - 1, (int)std::floor(hi * resolution - 0.5));
+            if (colBegin > colEnd) {
+                continue;
+            }
+            emit(py, colBegin, colEnd);
+        }
+    }
+
+    // Vacant pixels in the union of the spans of pixel row py (the spans get sorted)
+    long long vacantInSpans(int py, std::vector<std::pair<int, int>>& spans) const {
+        if (spans.empty()) {
+            return 0;
+        }
+        std::sort(spans.begin(), spans.end());
+
+        long long count = 0;
+        int begin = spans[0].first;
+        int end = spans[0].second;
+        for (size_t k = 1; k <= spans.size(); ++k) {
+            if (k < spans.size() && spans[k].first <= end + 1) {
+                end = std::max(end, spans[k].second);
+                continue;
+            }
+            count += vacantInRow(py, begin, end);
+            if (k < spans.size()) {
+                begin = spans[k].first;
+                end = spans[k].second;
+            }
+        }
+        return count;
+    }
+
+    int getPixelRows() const {
+        return height;
+    }
+
+private:
+    const OccupancyPyramid* occupancy;
+    int resolution;
+    double halfWidth;
+    int pixelsPerCell;
+    int width;
+    int height;
+    long long vacantCount = 0;
+    long long illuminatedCount = 0;
+    std::vector<std::vector<std::pair<int, int>>> rowSpans; // Lit pixel columns [first, second] per row
+    std::vector<int> touchedRows;
+
+    // Merge the spans of a row, count their vacant pixels and clear the row
+    long long countRow(int py) {
+        long long count = vacantInSpans(py, rowSpans[py]);
+        rowSpans[py].clear();
+        return count;
+    }
+
+    // Vacant pixels among columns [c0, c1] of pixel row py
+    long long vacantInRow(int py, int c0, int c1) const {
+        int j = py / pixelsPerCell;
+        int i0 = c0 / pixelsPerCell;
+        int i1 = c1 / pixelsPerCell;
+        long long blocked;
+        if (i0 == i1) {
+            blocked = occupancy->isBlocked(i0, j) ? c1 - c0 + 1 : 0;
+        } else {
+            // Partial cells at both ends, whole cells in between
+            blocked = (occupancy->isBlocked(i0, j) ? (i0 + 1) * pixelsPerCell - c0 : 0) +
+                      (occupancy->isBlocked(i1, j) ? c1 - i1 * pixelsPerCell + 1 : 0) +
+                      (long long)occupancy->blockedInRow(j, i0 + 1, i1 - 1) * pixelsPerCell;
+        }
+        return (c1 - c0 + 1) - blocked;
+    }
+
+    // Intersect [lo, hi] with the x values satisfying lower <= coef * x + offset <= upper
+    static void clipLinear(double coef, double offset, double lower, double upper, double& lo, double& hi) {
+        if (coef == 0) {
+            if (offset < lower || offset > upper) {
+                lo = 1;
+                hi = 0;
+            }
+            return;
+        }
+        double x1 = (lower - offset) / coef;
+        double x2 = (upper - offset) / coef;
+        lo = std::max(lo, std::min(x1, x2));
+        hi = std::min(hi, std::max(x1, x2));
+    }
+
+    // Widen [lo, hi] by the chord of the circle around c on the horizontal line y
+    void addCircle(const Vector2& c, double y, double& lo, double& hi) const {
+        double dy = y - c.y;
+        double r2 = halfWidth * halfWidth - dy * dy;
+        if (r2 < 0) {
+            return;
+        }
+        double dx = std::sqrt(r2);
+        lo = std::min(lo, c.x - dx);
+        hi = std::max(hi, c.x + dx);
+    }
+
+    // Record the pixels within halfWidth of the segment [a, b]. The capsule is convex,
+    // so each pixel row is covered by a single span.
+    void drawCapsule(const Vector2& a, const Vector2& b) {
+        forEachCapsuleRow(a, b, [this](int py, int colBegin, int colEnd) {
+            if (rowSpans[py].empty()) {
+                touchedRows.push_back(py);
+            }
+            rowSpans[py].emplace_back(colBegin, colEnd);
+        });
+    }
+};
+
+#endif // SCORER_H
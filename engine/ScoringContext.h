@@ -0,0 +1,35 @@
+#ifndef SCORING_CONTEXT_H
+#define SCORING_CONTEXT_H
+
+#include "Temple.h"
+#include "Lamp.h"
+#include "Mirror.h"
+#include "Validation.h"
+#include "Scorer.h"
+#include <vector>
+
+// Everything one worker needs to score candidate solutions on its own: a private
+// copy of the lamp and mirrors to modify, a scorer with its own row buffers and
+// the last traced path. Workers never share a context, so no locking is needed.
+struct ScoringContext
+{
+    const Temple *temple;
+    Lamp lamp;
+    std::vector<Mirror> mirrors;
+    Scorer scorer;
+    Path path;
+
+    ScoringContext(const Temple &templeRef, int pixelsPerUnit)
+        : temple(&templeRef), lamp({0, 0}, 0), scorer(templeRef, pixelsPerUnit)
+    {
+    }
+
+    // Trace the current lamp and mirrors and return the illuminated percentage
+    double evaluate()
+    {
+        path = Validation::raytrace(*temple, lamp, mirrors);
+        return scorer.evaluatePath(path);
+    }
+};
+
+#endif // SCORING_CONTEXT_H
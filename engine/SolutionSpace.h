@@ -0,0 +1,134 @@
+#ifndef SOLUTION_SPACE_H
+#define SOLUTION_SPACE_H
+
+#include "../math/Vector2.h"
+#include "Temple.h"
+#include "Lamp.h"
+#include "Mirror.h"
+#include <vector>
+#include <cmath>
+#include <random>
+#include <algorithm>
+
+// Flat encoding of a whole solution for the continuous optimizers: the lamp
+// (x, y, angle) followed by (x, y, angle) of every mirror, the same rows as a
+// cmc24_solution matrix. Positions are bounded by the temple size, angles are
+// periodic in [0, 2 pi).
+class SolutionSpace {
+public:
+    explicit SolutionSpace(const Temple& temple)
+        : mirrors(temple.getSpec().mirror_count),
+          mirrorLength(temple.getSpec().mirror_length) {
+        auto size = temple.getSize();
+        sizeX = size.first;
+        sizeY = size.second;
+    }
+
+    int dimensions() const {
+        return 3 * (mirrors + 1);
+    }
+
+    int mirrorCount() const {
+        return mirrors;
+    }
+
+    static bool isAngle(int d) {
+        return d % 3 == 2;
+    }
+
+    double lower(int) const {
+        return 0;
+    }
+
+    double upper(int d) const {
+        switch (d % 3) {
+        case 0:
+            return sizeX;
+        case 1:
+            return sizeY;
+        default:
+            return 2 * M_PI;
+        }
+    }
+
+    double extent(int d) const {
+        return upper(d) - lower(d);
+    }
+
+    // Angle in [0, 2 pi)
+    static double wrapAngle(double angle) {
+        double wrapped = std::fmod(angle, 2 * M_PI);
+        if (wrapped < 0) {
+            wrapped += 2 * M_PI;
+        }
+        return wrapped < 2 * M_PI ? wrapped : 0;
+    }
+
+    // Shortest signed rotation from `from` to `to`, in [-pi, pi)
+    static double angleDifference(double to, double from) {
+        return wrapAngle(to - from + M_PI) - M_PI;
+    }
+
+    // Difference to - from along dimension d, going around for angles
+    static double difference(int d, double to, double from) {
+        return isAngle(d) ? angleDifference(to, from) : to - from;
+    }
+
+    // Clamp positions into the temple and wrap angles
+    void normalize(std::vector<double>& x) const {
+        for (int d = 0; d < dimensions(); ++d) {
+            x[d] = isAngle(d) ? wrapAngle(x[d]) : std::min(std::max(x[d], lower(d)), upper(d));
+        }
+    }
+
+    std::vector<double> randomPoint(std::mt19937_64& rng) const {
+        std::vector<double> x(dimensions());
+        for (int d = 0; d < dimensions(); ++d) {
+            std::uniform_real_distribution<> dis(lower(d), upper(d));
+            x[d] = dis(rng);
+        }
+        normalize(x);
+        return x;
+    }
+
+    void decode(const std::vector<double>& x, Lamp& lamp, std::vector<Mirror>& mirrorList) const {
+        lamp.updateLamp({x[0], x[1]}, x[2]);
+        if ((int)mirrorList.size() != mirrors) {
+            mirrorList.assign(mirrors, Mirror({0, 0}, 0, mirrorLength));
+        }
+        for (int m = 0; m < mirrors; ++m) {
+            const double* row = &x[3 * (m + 1)];
+            mirrorList[m].updateMirror({row[0], row[1]}, row[2], mirrorLength);
+        }
+    }
+
+    std::vector<double> encode(const Lamp& lamp, const std::vector<Mirror>& mirrorList) const {
+        std::vector<double> x(dimensions(), 0);
+        x[0] = lamp.v.x;
+        x[1] = lamp.v.y;
+        x[2] = lamp.angle;
+        for (int m = 0; m < mirrors && m < (int)mirrorList.size(); ++m) {
+            x[3 * (m + 1)] = mirrorList[m].v1.x;
+            x[3 * (m + 1) + 1] = mirrorList[m].v1.y;
+            x[3 * (m + 1) + 2] = mirrorList[m].angle;
+        }
+        return x;
+    }
+
+    // Rows of a cmc24_solution matrix, as read by Validation::load_solution
+    std::vector<std::vector<double>> toSolution(const std::vector<double>& x) const {
+        std::vector<std::vector<double>> solution;
+        for (int row = 0; row <= mirrors; ++row) {
+            solution.push_back({x[3 * row], x[3 * row + 1], x[3 * row + 2]});
+        }
+        return solution;
+    }
+
+private:
+    int mirrors;
+    double mirrorLength;
+    double sizeX;
+    double sizeY;
+};
+
+#endif // SOLUTION_SPACE_H
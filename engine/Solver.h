@@ -1,8 +1,10 @@
 #ifndef SOLVER_H
 #define SOLVER_H
 
-#include <SFML/Graphics.hpp>
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <iostream>
 #include <random>
 #include <iomanip>
 #include "../math/Vector2.h"
@@ -10,17 +12,40 @@
 #include "Lamp.h"
 #include "Mirror.h"
 #include "Validation.h"
+#include "Scorer.h"
+#include "ScoringContext.h"
+#include "ThreadPool.h"
+#include "SolutionSpace.h"
+#include "Repair.h"
+#include "Annealing.h"
+#include "BatchEvaluator.h"
+#include "CMAES.h"
+#include "DifferentialEvolution.h"
+#include "BeamSearch.h"
+#include "Polisher.h"
+#include "WaypointSolver.h"
+#include "VisibilityGraph.h"
+#include "BranchAndBound.h"
+#include "BoundaryPoses.h"
+#include "Symmetry.h"
+#include "LampSearch.h"
+#include "IslandModel.h"
+#include "ParallelTempering.h"
+#include "TabuSearch.h"
 
 // Particle structure for PSO
 struct Particle
 {
-    std::vector<double> position;     // Position (24 values: x, y, angle for each of 8 mirrors)
-    std::vector<double> velocity;     // Velocity (24 values)
+    std::vector<double> position;     // Position (x, y, angle of the lamp, then of every mirror)
+    std::vector<double> velocity;     // Velocity (same dimensions)
     std::vector<double> bestPosition; // Personal best position
-    int bestFitness = 0;              // Best fitness score (as an integer)
+    double bestFitness = -1;          // Best fitness score (illuminated percentage)
+    std::mt19937_64 rng;              // Own random stream, so runs don't depend on the thread count
 
-    Particle(int dimensions)
+    Particle(int dimensions, unsigned long long seed, int index)
     {
+        std::seed_seq sequence{(unsigned)seed, (unsigned)(seed >> 32), (unsigned)index};
+        rng.seed(sequence);
         position.resize(dimensions);
         velocity.resize(dimensions);
         bestPosition.resize(dimensions);
@@ -30,33 +55,35 @@ struct Particle
 class Solver
 {
 private:
-    sf::RenderTexture renderTexture; // Off-screen render texture
-    sf::ContextSettings settings;
     float scaleFactor;
     Temple *temple;
     Lamp *lamp;                   // Pointer to a Lamp object
     std::vector<Mirror> &mirrors; // Pointer to a list of Mirror objects
     Path *path;                   // Pointer to a Path object
+    Scorer scorer;                // Coverage scorer compiled from the temple
+    SolutionSpace space;          // Flat encoding of lamp + mirrors for the continuous optimizers
+    ThreadPool pool;              // Workers for the parallel searches
+    std::vector<ScoringContext> contexts; // One scoring context per pool worker
+    BatchEvaluator batch;         // Parallel repair + scoring of encoded solutions
 
     // PSO Parameters
     int swarmSize = 100;  // Number of particles in the swarm
     int iterations = 200; // Number of iterations for PSO
 
+    int refineSeeds = 64; // Grid winners of findMaxMirror refined off the grid
+    double boundaryFraction = 0.5; // Share of elements runDE seeds on block faces and corners
+
 public:
-    Solver(Temple *TemplePtr, Lamp *lampPtr, std::vector<Mirror> &mirrorsPtr, Path *pathPtr, float scale = 20.0f)
-        : scaleFactor(scale), temple(TemplePtr), lamp(lampPtr), mirrors(mirrorsPtr), path(pathPtr)
+    // threads == 0 uses every hardware thread
+    Solver(Temple *TemplePtr, Lamp *lampPtr, std::vector<Mirror> &mirrorsPtr, Path *pathPtr, float scale = 20.0f, int threads = 0)
+        : scaleFactor(scale), temple(TemplePtr), lamp(lampPtr), mirrors(mirrorsPtr), path(pathPtr),
+          scorer(*TemplePtr, (int)std::lround(scale)), space(*TemplePtr), pool(threads),
+          batch(*TemplePtr, pool, contexts)
     {
-
-        auto templeSize = temple->getSize();
-        int templeWidth = templeSize.first * scaleFactor;
-        int templeHeight = templeSize.second * scaleFactor;
-
-        settings.antialiasingLevel = 0; // Antialiasing setting
-
-        // Create the render texture (without GUI space)
-        if (!renderTexture.create(templeWidth, templeHeight, settings))
+        contexts.reserve(pool.size());
+        for (int i = 0; i < pool.size(); ++i)
         {
-            std::cerr << "Failed to create render texture!" << std::endl;
+            contexts.emplace_back(*TemplePtr, (int)std::lround(scale));
         }
     }
 
@@ -69,137 +96,170 @@ public:
         // lamp->updateLamp({1.023479, 6.738761}, 5.908759997);
         lamp->updateLamp({11.023478, 11.477104}, 5.24876000564);
 
+        const int mirrorCount = temple->getSpec().mirror_count;
+        for (int m = 0; m < mirrorCount; ++m)
+        {
+            *path = Validation::raytrace(*temple, *lamp, mirrors);
+            findMaxMirror(m);
+            printf("Solved mirror %d\n", m + 1);
+        }
         *path = Validation::raytrace(*temple, *lamp, mirrors);
-        findMaxMirror(0);
-        printf("Solved first mirror\n");
-        *path = Validation::raytrace(*temple, *lamp, mirrors);
-        findMaxMirror(1);
-        printf("Solved second mirror\n");
-        *path = Validation::raytrace(*temple, *lamp, mirrors);
-        findMaxMirror(2);
-        printf("Solved third mirror\n");
-        *path = Validation::raytrace(*temple, *lamp, mirrors);
-        findMaxMirror(3);
-        printf("Solved fourth mirror\n");
-        *path = Validation::raytrace(*temple, *lamp, mirrors);
-        findMaxMirror(4);
-        printf("Solved fifth mirror\n");
-        *path = Validation::raytrace(*temple, *lamp, mirrors);
-        findMaxMirror(5);
-        printf("Solved sixth mirror\n");
-        *path = Validation::raytrace(*temple, *lamp, mirrors);
-        findMaxMirror(6);
-        printf("Solved seventh mirror\n");
-        *path = Validation::raytrace(*temple, *lamp, mirrors);
-        findMaxMirror(7);
-        printf("Solved eight mirror\n");
+
+        printf("Print all %d mirrors\n", mirrorCount);
+        printMirrorPositions();
+    }
+
+    // Sequential placement like runGreedy, but keeping the best beamWidth partial solutions
+    // at every depth. Starts from the current lamp (moved to the nearest legal pose if needed).
+    void runBeam(int beamWidth = 8)
+    {
+        Repair::repairLamp(*temple, *lamp);
+
+        BeamOptions options;
+        options.beamWidth = beamWidth;
+        BeamSearch beam(*temple, pool, contexts, options);
+        BeamState best = beam.run(*lamp, temple->getSpec().mirror_count);
+        *lamp = best.lamp;
+        mirrors = best.mirrors;
+
         *path = Validation::raytrace(*temple, *lamp, mirrors);
+        printf("Beam search best = %.4f after %lld evaluations\n", best.score, beam.getEvaluations());
+        printMirrorPositions();
+    }
 
-        printf("Print all 8 mirrors\n");
+    // Branch-and-bound over sequential placement on a coarse grid of mirror poses, with a
+    // beam search on the same grid for the first incumbent. mirrorCount < 0 places all
+    // mirrors; the search proves optimality (for the grid) if it finishes in time.
+    void runBranchAndBound(int mirrorCount = -1, double seconds = 60, double positionStep = 1.0, int angleCount = 36)
+    {
+        Repair::repairLamp(*temple, *lamp);
+        if (mirrorCount < 0)
+        {
+            mirrorCount = temple->getSpec().mirror_count;
+        }
+
+        BeamOptions beamOptions;
+        beamOptions.beamWidth = 4;
+        beamOptions.positionStep = positionStep;
+        beamOptions.angleCount = angleCount;
+        beamOptions.report = false;
+        BeamState incumbent = BeamSearch(*temple, pool, contexts, beamOptions).run(*lamp, mirrorCount);
+
+        BranchAndBoundOptions options;
+        options.positionStep = positionStep;
+        options.angleCount = angleCount;
+        options.seconds = seconds;
+        options.incumbent = (int)incumbent.mirrors.size() == mirrorCount ? incumbent.score : 0;
+        mirrors = incumbent.mirrors;
+        BranchAndBound search(*temple, pool, contexts, options);
+        printf("Beam incumbent %.4f, leg bound %.4f\n", options.incumbent, search.getLegBound());
+        search.run(*lamp, mirrors, mirrorCount);
+
+        *path = Validation::raytrace(*temple, *lamp, mirrors);
         printMirrorPositions();
     }
 
-    // Main PSO run function
-    void runPSO()
+    // Main PSO run function. Fitness evaluations run in parallel, one particle per task; every
+    // particle draws from its own seeded stream and the global best is reduced serially in
+    // particle order, so a run is reproducible for a given seed with any number of threads.
+    // The search space is the lamp plus all mirrors, bounded by the temple size, with
+    // periodic angles; the best solution found is left in the lamp, mirrors and path.
+    void runPSO(unsigned long long seed = 1)
     {
-        lamp->updateLamp({1.0001, 6.71001}, 0.345575);
-        int dimensions = 24; // 8 mirrors, each with (x, y, angle)
+        int dimensions = space.dimensions(); // Lamp and every mirror, each with (x, y, angle)
 
         // Initialize swarm
-        initializeSwarm(dimensions);
+        initializeSwarm(dimensions, seed);
+        std::vector<double> fitness(swarm.size());
 
         for (int iter = 0; iter < iterations; ++iter)
         {
-            // For each particle, evaluate fitness and update velocity/position
-            for (Particle &particle : swarm)
-            {
-                int fitness = evaluateFitness(particle.position); // Fitness is now an integer (pixel count)
+            // Evaluate fitness and update personal bests in parallel
+            pool.parallelFor(swarm.size(), [&](int worker, size_t i)
+                             {
+                Particle &particle = swarm[i];
+                fitness[i] = evaluateFitness(particle.position, contexts[worker]);
 
                 // Update personal best
-                if (fitness > particle.bestFitness)
+                if (fitness[i] > particle.bestFitness)
                 {
-                    particle.bestFitness = fitness;
+                    particle.bestFitness = fitness[i];
                     particle.bestPosition = particle.position;
-                }
+                } });
 
-                // Update global best
-                if (fitness > globalBestFitness)
+            // Update global best
+            for (size_t i = 0; i < swarm.size(); ++i)
+            {
+                if (fitness[i] > globalBestFitness)
                 {
-                    globalBestFitness = fitness;
-                    globalBestPosition = particle.position;
+                    globalBestFitness = fitness[i];
+                    globalBestPosition = swarm[i].position;
                 }
             }
 
             // Update velocities and positions of particles
-            for (Particle &particle : swarm)
-            {
-                for (int d = 0; d < dimensions; ++d)
-                {
-                    double r1 = randomDouble(0.0, 1.0);
-                    double r2 = randomDouble(0.0, 1.0);
-
-                    // PSO velocity update formula
-                    particle.velocity[d] = 0.5 * particle.velocity[d] +
-                                           1.5 * r1 * (particle.bestPosition[d] - particle.position[d]) +
-                                           2.0 * r2 * (globalBestPosition[d] - particle.position[d]) +
-                                           randomDouble(-0.5, 0.5); // Add random noise
-
-                    // Update position
-                    particle.position[d] += particle.velocity[d];
-                    if (particle.position[d] < 0)
-                        particle.position[d] = 0;
-                    if (particle.position[d] > 10)
-                        particle.position[d] = 10;
-                }
-            }
+            pool.parallelFor(swarm.size(), [&](int, size_t i)
+                             { moveParticle(swarm[i], dimensions); });
 
             std::cout << "Iteration " << iter << ": Best fitness = " << globalBestFitness << std::endl;
             // printParticlePosition(swarm[0]);
         }
+
+        space.decode(globalBestPosition, *lamp, mirrors);
+        *path = Validation::raytrace(*temple, *lamp, mirrors);
         printGlobalBestPosition();
     }
 
-    // Evaluate fitness using the current Solver's evaluatePath method
-    double evaluateFitness(const std::vector<double> &particlePosition)
+    void moveParticle(Particle &particle, int dimensions)
     {
-        // Update mirrors based on particle position with scaling
-        for (int i = 0; i < mirrors.size(); ++i)
+        for (int d = 0; d < dimensions; ++d)
         {
-            // Scale x and y positions from [0, 10] to [1, 19]
-            double scaledX = 1 + (particlePosition[i * 3] * 18.0 / 10.0);
-            double scaledY = 1 + (particlePosition[i * 3 + 1] * 18.0 / 10.0);
-
-            // Scale angle from [0, 10] to [0, 2π]
-            double scaledAngle = (particlePosition[i * 3 + 2] * 2.0 * M_PI / 10.0);
-
-            mirrors[i].updateMirror({scaledX, scaledY}, scaledAngle);
+            double r1 = randomDouble(particle.rng, 0.0, 1.0);
+            double r2 = randomDouble(particle.rng, 0.0, 1.0);
+            double noise = 0.05 * space.extent(d);
+
+            // PSO velocity update formula, attraction goes the short way around for angles
+            particle.velocity[d] = 0.5 * particle.velocity[d] +
+                                   1.5 * r1 * SolutionSpace::difference(d, particle.bestPosition[d], particle.position[d]) +
+                                   2.0 * r2 * SolutionSpace::difference(d, globalBestPosition[d], particle.position[d]) +
+                                   randomDouble(particle.rng, -noise, noise); // Add random noise
+
+            // Update position
+            particle.position[d] += particle.velocity[d];
         }
+        // Clamp positions into the temple, wrap angles
+        space.normalize(particle.position);
+    }
 
-        // Use raytrace and evaluatePath for fitness calculation
-        *path = Validation::raytrace(*temple, *lamp, mirrors);
-        return evaluatePath(*path); // Return the number of illuminated pixels
+    // Evaluate fitness of a particle position in the given worker context. The position is
+    // repaired in place first; one that can't be made feasible scores 0.
+    double evaluateFitness(std::vector<double> &particlePosition, ScoringContext &context)
+    {
+        return batch.evaluate(particlePosition, context); // Illuminated percentage
     }
 
     // PSO-related members
     std::vector<Particle> swarm;
     std::vector<double> globalBestPosition; // Best position found by the swarm
-    int globalBestFitness = 0;              // Best fitness of the swarm (as an integer)
+    double globalBestFitness = -1;          // Best fitness of the swarm (illuminated percentage)
 
     // Initialize swarm with random positions and velocities
-    void initializeSwarm(int dimensions)
+    void initializeSwarm(int dimensions, unsigned long long seed)
     {
         swarm.clear();
-        globalBestPosition.resize(dimensions);
+        globalBestPosition.assign(dimensions, 0);
+        globalBestFitness = -1;
 
         for (int i = 0; i < swarmSize; ++i)
         {
-            Particle particle(dimensions);
+            Particle particle(dimensions, seed, i);
 
             // Initialize other particles randomly
+            particle.position = space.randomPoint(particle.rng); // Random positions
             for (int d = 0; d < dimensions; ++d)
             {
-                particle.position[d] = randomDouble(0.0, 10.0); // Random positions
-                particle.velocity[d] = randomDouble(-1.0, 1.0); // Initialize velocities randomly
+                double speed = 0.1 * space.extent(d);
+                particle.velocity[d] = randomDouble(particle.rng, -speed, speed); // Initialize velocities randomly
             }
 
             particle.bestPosition = particle.position;
@@ -207,13 +267,11 @@ public:
         }
     }
 
-    // Random number generator for position/velocity initialization
-    double randomDouble(double min, double max)
+    // Uniform random number from a particle's own stream
+    static double randomDouble(std::mt19937_64 &rng, double min, double max)
     {
-        static std::random_device rd;
-        static std::mt19937 gen(rd());
         std::uniform_real_distribution<> dis(min, max);
-        return dis(gen);
+        return dis(rng);
     }
 
     // Assuming globalBestPosition is a member of your class, if not, adjust accordingly
@@ -224,7 +282,7 @@ public:
         for (size_t i = 0; i < globalBestPosition.size() / 3; ++i)
         {
             std::cout << "    {"
-                      << std::fixed << std::setprecision(5)
+                      << std::fixed << std::setprecision(6)
                       << globalBestPosition[i * 3] << ", "
                       << globalBestPosition[i * 3 + 1] << ", "
                       << globalBestPosition[i * 3 + 2] << "},"; // Use comma after each entry
@@ -254,171 +312,476 @@ public:
         std::cout << "};" << std::endl; // Closing bracket
     }
 
+    // Simulated annealing from the current solution (or a random one if it isn't complete
+    // and valid) for the given number of seconds; the best solution is kept
+    void runAnnealing(double seconds = 60, unsigned long long seed = 1)
+    {
+        prepareStart(seed);
+
+        AnnealingOptions options;
+        options.seconds = seconds;
+        options.seed = seed;
+        SimulatedAnnealing annealing(*temple, (int)std::lround(scaleFactor), options);
+        annealing.run(*lamp, mirrors);
+
+        *path = Validation::raytrace(*temple, *lamp, mirrors);
+        printMirrorPositions();
+    }
+
+    // Replica exchange over `replicas` temperatures from the current solution (or a random
+    // one if it isn't complete and valid), the replicas in parallel on the pool
+    void runTempering(double seconds = 60, int replicas = 8, unsigned long long seed = 1)
+    {
+        prepareStart(seed);
+
+        TemperingOptions options;
+        options.replicas = replicas;
+        options.seconds = seconds;
+        options.seed = seed;
+        ParallelTempering tempering(*temple, (int)std::lround(scaleFactor), pool, options);
+        tempering.run(*lamp, mirrors);
+
+        *path = Validation::raytrace(*temple, *lamp, mirrors);
+        printMirrorPositions();
+    }
+
+    // Tabu search on a lattice of poses around the current solution (or a random one if
+    // it isn't complete and valid); neighbourhoods are scored in parallel
+    void runTabu(double seconds = 60, double positionStep = 0.01, int angleSteps = 3600, unsigned long long seed = 1)
+    {
+        prepareStart(seed);
+
+        TabuOptions options;
+        options.seconds = seconds;
+        options.positionStep = positionStep;
+        options.angleSteps = angleSteps;
+        TabuSearch tabu(*temple, pool, contexts, options);
+        tabu.run(*lamp, mirrors);
+
+        *path = Validation::raytrace(*temple, *lamp, mirrors);
+        printMirrorPositions();
+    }
+
+    // CMA-ES from the current solution (or a random one if it isn't complete and valid),
+    // with restarts; meant for polishing good layouts
+    void runCMAES(double seconds = 60, unsigned long long seed = 1, CMAESRestarts restarts = CMAESRestarts::BIPOP)
+    {
+        prepareStart(seed);
+
+        CMAESOptions options;
+        options.seconds = seconds;
+        options.seed = seed;
+        options.restarts = restarts;
+        CMAES cmaes(batch, options);
+        std::vector<double> x = space.encode(*lamp, mirrors);
+        double best = cmaes.run(x);
+        space.decode(x, *lamp, mirrors);
+
+        *path = Validation::raytrace(*temple, *lamp, mirrors);
+        printf("CMA-ES best = %.4f after %zu generations\n", best, cmaes.getHistory().size());
+        printMirrorPositions();
+    }
+
+    // Differential evolution (DE/rand-to-best/1/bin with jDE) seeded with the current solution
+    void runDE(double seconds = 60, unsigned long long seed = 1)
+    {
+        prepareStart(seed);
+
+        DEOptions options;
+        options.seconds = seconds;
+        options.seed = seed;
+        DifferentialEvolution de(batch, options);
+        std::vector<double> x = space.encode(*lamp, mirrors);
+
+        // Half of the population starts with its elements on block faces and corners
+        BoundaryPoses boundary(*temple);
+        std::mt19937_64 rng(seed);
+        std::vector<std::vector<double>> seeds(options.populationSize / 2);
+        for (std::vector<double> &s : seeds)
+        {
+            s = boundary.randomPoint(rng, space, boundaryFraction);
+        }
+        double best = de.run(x, seeds);
+        space.decode(x, *lamp, mirrors);
+
+        *path = Validation::raytrace(*temple, *lamp, mirrors);
+        printf("DE best = %.4f after %d generations\n", best, de.getGeneration());
+        printMirrorPositions();
+    }
+
+    // Differential evolution on `islands` populations with their own threads (0 for one per
+    // hardware thread), exchanging their best members on a ring; seeded like runDE
+    void runIslands(double seconds = 60, int islands = 0, unsigned long long seed = 1)
+    {
+        prepareStart(seed);
+
+        IslandOptions options;
+        options.islands = islands;
+        options.seconds = seconds;
+        options.seed = seed;
+        IslandModel model(*temple, (int)std::lround(scaleFactor), options);
+        std::vector<double> x = space.encode(*lamp, mirrors);
+
+        BoundaryPoses boundary(*temple);
+        std::mt19937_64 rng(seed);
+        int islandCount = islands > 0 ? islands : std::max(1u, std::thread::hardware_concurrency());
+        std::vector<std::vector<double>> seeds(islandCount * options.populationSize / 2);
+        for (std::vector<double> &s : seeds)
+        {
+            s = boundary.randomPoint(rng, space, boundaryFraction);
+        }
+        model.run(x, seeds);
+        space.decode(x, *lamp, mirrors);
+
+        *path = Validation::raytrace(*temple, *lamp, mirrors);
+        printMirrorPositions();
+    }
+
+    // Search over waypoint sequences with the mirror angles derived from them
+    void runWaypoints(double seconds = 60, unsigned long long seed = 1)
+    {
+        WaypointOptions options;
+        options.seconds = seconds;
+        options.seed = seed;
+        WaypointSolver solver(*temple, pool, contexts, options);
+        solver.run(*lamp, mirrors);
+
+        *path = Validation::raytrace(*temple, *lamp, mirrors);
+        printMirrorPositions();
+    }
+
+    // Longest chains on the temple's visibility graph (built and saved to graphFile on the
+    // first run), turned into mirror layouts through their waypoints and scored exactly;
+    // the best valid one is polished
+    void runVisibilityGraph(const std::string &graphFile = "visibility.graph", double searchSeconds = 30, double polishSeconds = 30)
+    {
+        VisibilityGraph graph;
+        if (!loadGraph(graph, graphFile))
+        {
+            return;
+        }
+        ChainSearchOptions options;
+        options.seconds = searchSeconds;
+        finishChains(graph, graph.longestChains(*temple, temple->getSpec().mirror_count, options), polishSeconds);
+    }
+
+    // Like runVisibilityGraph, with the chains found by meet-in-the-middle: forward and
+    // backward halves joined on their junction legs
+    void runMeetInTheMiddle(const std::string &graphFile = "visibility.graph", int width = 2000, double polishSeconds = 30)
+    {
+        VisibilityGraph graph;
+        if (!loadGraph(graph, graphFile))
+        {
+            return;
+        }
+        MeetOptions options;
+        options.width = width;
+        finishChains(graph, graph.meetInTheMiddle(*temple, temple->getSpec().mirror_count, options), polishSeconds);
+    }
+
+    bool loadGraph(VisibilityGraph &graph, const std::string &graphFile)
+    {
+        if (!graph.loadOrBuild(graphFile, *temple))
+        {
+            return false;
+        }
+        printf("Visibility graph: %zu vertices, %zu edges\n", graph.getVertices().size(), graph.getEdges().size());
+        return true;
+    }
+
+    // Score the chains exactly in parallel, keep the best valid one and polish it
+    void finishChains(const VisibilityGraph &graph, const std::vector<VisibilityGraph::Chain> &chains, double polishSeconds)
+    {
+        if (chains.empty())
+        {
+            std::cerr << "ERROR! The visibility graph has no chain with " << temple->getSpec().mirror_count << " mirrors." << std::endl;
+            return;
+        }
+
+        auto toPoints = [&](const VisibilityGraph::Chain &chain)
+        {
+            std::vector<Vector2> points;
+            for (int vertex : chain.vertices)
+            {
+                points.push_back(graph.getVertices()[vertex]);
+            }
+            return points;
+        };
+        std::vector<double> scores(chains.size(), 0);
+        pool.parallelFor(chains.size(), [&](int worker, size_t i)
+                         {
+            ScoringContext &context = contexts[worker];
+            if (WaypointSolver::toSolution(toPoints(chains[i]), temple->getSpec().mirror_length, context.lamp, context.mirrors) &&
+                Validation::check_solution(*temple, context.lamp, context.mirrors, false))
+            {
+                scores[i] = context.evaluate();
+            } });
+
+        size_t best = std::max_element(scores.begin(), scores.end()) - scores.begin();
+        printf("Best chain: graph estimate %.4f, exact %.4f (%zu chains)\n", graph.percentage(chains[best].coverage), scores[best], chains.size());
+        if (scores[best] <= 0)
+        {
+            std::cerr << "ERROR! None of the chains gives a valid solution." << std::endl;
+            return;
+        }
+        WaypointSolver::toSolution(toPoints(chains[best]), temple->getSpec().mirror_length, *lamp, mirrors);
+
+        PolishOptions polish;
+        polish.seconds = polishSeconds;
+        Polisher(*temple, polish).polish(*lamp, mirrors);
+
+        *path = Validation::raytrace(*temple, *lamp, mirrors);
+        printMirrorPositions();
+    }
+
+    // Coordinate descent + Nelder-Mead at high resolution; the solution stays valid
+    void runPolish(double seconds = 60, int pixelsPerUnit = 150)
+    {
+        prepareStart(1);
+
+        PolishOptions options;
+        options.seconds = seconds;
+        options.pixelsPerUnit = pixelsPerUnit;
+        Polisher polisher(*temple, options);
+        polisher.polish(*lamp, mirrors);
+
+        *path = Validation::raytrace(*temple, *lamp, mirrors);
+        printMirrorPositions();
+    }
+
+    // Leave a feasible solution in lamp and mirrors to start a local search from: the
+    // current one if it is complete and valid, a repaired random one otherwise
+    void prepareStart(unsigned long long seed)
+    {
+        if ((int)mirrors.size() == space.mirrorCount() && Validation::check_solution(*temple, *lamp, mirrors, false))
+        {
+            return;
+        }
+        std::mt19937_64 rng(seed);
+        std::vector<double> start = space.randomPoint(rng);
+        Repair::repair(*temple, space, start, *lamp, mirrors);
+    }
+
+    // Best pose for mirror idx on the current beam segment: positions every 0.2 along the
+    // segment times 720 angles. The grid is split into chunks scored in parallel, each worker
+    // with its own context; the reduction keeps the first best candidate in scan order
+    // (positions, then angles), so the result is the same as a serial scan. Poses that
+    // don't fit (see mirrorFits) are skipped. The best refineSeeds chunk winners are then
+    // refined off the grid (see refineMirror).
     void findMaxMirror(const int &idx)
     {
-        Path tempPath;
-        Mirror maxMirror({0, 0}, 0);
+        Mirror maxMirror({0, 0}, 0, temple->getSpec().mirror_length);
         double maxSol = 0;
         mirrors.push_back(maxMirror);
+
+        std::vector<Vector2> positions;
         bool left = false;
         if (path->directions[idx].x < 0)
             left = true;
         for (Vector2 v = path->points[idx]; left ^ (v < path->points[idx + 1]); v = v + path->directions[idx] * 0.2)
         {
-            for (double angle = 0; angle < M_PI * 2; angle += M_PI / 360)
+            positions.push_back(v);
+        }
+        std::vector<double> angles;
+        for (double angle = 0; angle < M_PI * 2; angle += M_PI / 360)
+        {
+            angles.push_back(angle);
+        }
+
+        for (ScoringContext &context : contexts)
+        {
+            context.lamp = *lamp;
+            context.mirrors = mirrors;
+        }
+
+        // Chunk c covers angles [c * anglesPerChunk, ...) of one position
+        const size_t anglesPerChunk = 90;
+        const size_t chunksPerPosition = (angles.size() + anglesPerChunk - 1) / anglesPerChunk;
+        std::vector<double> chunkBest(positions.size() * chunksPerPosition, 0);
+        std::vector<size_t> chunkBestAngle(chunkBest.size(), 0);
+
+        pool.parallelFor(chunkBest.size(), [&](int worker, size_t chunk)
+                         {
+            ScoringContext &context = contexts[worker];
+            const Vector2 &v = positions[chunk / chunksPerPosition];
+            size_t first = (chunk % chunksPerPosition) * anglesPerChunk;
+            size_t last = std::min(first + anglesPerChunk, angles.size());
+            for (size_t a = first; a < last; ++a)
+            {
+                context.mirrors[idx].updateMirror(v - Vector2(0.001, 0.001), angles[a]);
+                if (!mirrorFits(context.mirrors, idx))
+                {
+                    continue;
+                }
+                double sol = context.evaluate();
+                if (sol > chunkBest[chunk])
+                {
+                    chunkBest[chunk] = sol;
+                    chunkBestAngle[chunk] = a;
+                }
+            } });
+
+        for (size_t p = 0; p < positions.size(); ++p)
+        {
+            for (size_t c = 0; c < chunksPerPosition; ++c)
             {
-                (mirrors)[idx].updateMirror(v - Vector2(0.001, 0.001), angle);
-                tempPath = Validation::raytrace(*temple, *lamp, mirrors);
-                double sol = evaluatePath(tempPath);
-                if (sol > maxSol)
+                size_t chunk = p * chunksPerPosition + c;
+                if (chunkBest[chunk] > maxSol)
                 {
-                    maxSol = sol;
-                    maxMirror = (mirrors)[idx];
+                    maxSol = chunkBest[chunk];
+                    maxMirror.updateMirror(positions[p] - Vector2(0.001, 0.001), angles[chunkBestAngle[chunk]]);
                 }
             }
-            printf("%.3lf %.3lf %5lf\n", v.x, v.y, maxSol);
+            printf("%.3lf %.3lf %5lf\n", positions[p].x, positions[p].y, maxSol);
         }
-        maxMirror.printMirrorDetails();
-        (mirrors)[idx] = maxMirror;
-    }
 
-    void findMaxLamp()
-    {
-        // tu stavit petlju ili loopove za trazenje rjesenja
-        int maxSol = 0;
-        Path tempPath;
-        Lamp maxLamp({0, 0}, 0);
-        ;
-        for (double x = 1.0000001; x < 10.5; x += 100)
+        // Refine the best chunk winners in parallel; ties keep the earlier seed
+        std::vector<size_t> order(chunkBest.size());
+        for (size_t i = 0; i < order.size(); ++i)
+        {
+            order[i] = i;
+        }
+        size_t seeds = std::min<size_t>(refineSeeds, order.size());
+        std::partial_sort(order.begin(), order.begin() + seeds, order.end(), [&](size_t a, size_t b)
+                          { return chunkBest[a] > chunkBest[b] || (chunkBest[a] == chunkBest[b] && a < b); });
+        // Chunks where no pose fit have no winner to start from
+        while (seeds > 0 && chunkBest[order[seeds - 1]] <= 0)
         {
-            for (double y = 6.00001; y < 7; y += 0.01)
+            --seeds;
+        }
+        std::vector<Mirror> refined(seeds, maxMirror);
+        std::vector<double> refinedScore(seeds, 0);
+        std::vector<int> refinedEvaluations(seeds, 0);
+        pool.parallelFor(seeds, [&](int worker, size_t i)
+                         {
+            size_t chunk = order[i];
+            refined[i].updateMirror(positions[chunk / chunksPerPosition] - Vector2(0.001, 0.001), angles[chunkBestAngle[chunk]]);
+            refinedScore[i] = refineMirror(contexts[worker], idx, refined[i], chunkBest[chunk], M_PI / 360, 0.1, refinedEvaluations[i]); });
+        int evaluations = 0;
+        double gridSol = maxSol;
+        for (size_t i = 0; i < seeds; ++i)
+        {
+            evaluations += refinedEvaluations[i];
+            if (refinedScore[i] > maxSol)
             {
-                for (double angle = 0; angle < M_PI * 2; angle += M_PI / 300)
-                {
-                    lamp->updateLamp(Vector2(x, y), angle);
-                    tempPath = Validation::raytrace(*temple, *lamp, mirrors);
-                    int sol = evaluatePath(tempPath);
-                    if (sol > maxSol)
-                    {
-                        maxSol = sol;
-                        maxLamp = *lamp;
-                    }
-                    printf("%.3lf %.3lf %.3lf %5d %5d\n", x, y, angle, sol, maxSol);
-                }
+                maxSol = refinedScore[i];
+                maxMirror = refined[i];
             }
         }
-        maxLamp.printLampDetails();
+        printf("Refined %zu seeds: %.5lf -> %.5lf (%d evaluations, grid %zu)\n", seeds, gridSol, maxSol, evaluations,
+               positions.size() * angles.size());
+        maxMirror.printMirrorDetails();
+        (mirrors)[idx] = maxMirror;
     }
 
-    // Method to draw the illuminated area based on the path
-    double evaluatePath(const Path &pathCurr)
+    // True if mirror idx stays clear of the blocks and of the mirrors placed before it
+    bool mirrorFits(const std::vector<Mirror> &placed, int idx) const
     {
-        if (&pathCurr)
-        {
-            renderTexture.clear(sf::Color(229, 222, 178, 255));
-
-            // Draw circles for each point in the path
-            sf::Color lightColor(255, 0, 0, 255); // Red
-            double halfWidth = 1.0;
+        return Repair::mirrorFeasible(*temple, placed[idx]) && !Repair::crossesAny(placed[idx], placed, idx);
+    }
 
-            for (const Vector2 &point : pathCurr.points)
+    // Local search around a grid winner: a golden-section search for the angle within one
+    // angle step either side, then a compass search of the position starting at half of
+    // positionStep, alternating until neither improves. findMaxMirror passes 0.1, so the
+    // compass starts at 0.05, a quarter of its 0.2 grid step. The score is piecewise constant,
+    // so only strict improvements are taken. Poses that don't fit (see mirrorFits) score
+    // -1, below any valid pose, so they never improve. Leaves the best pose in mirror and
+    // returns its score.
+    double refineMirror(ScoringContext &context, int idx, Mirror &mirror, double score, double angleStep, double positionStep, int &evaluations)
+    {
+        auto evaluate = [&](const Vector2 &v, double angle)
+        {
+            context.mirrors[idx].updateMirror(v, angle);
+            if (!mirrorFits(context.mirrors, idx))
             {
-                sf::CircleShape lightCircle(halfWidth * scaleFactor, 10); // DEFAULT JE 30, ali u skripti treba 1001
-                lightCircle.setFillColor(lightColor);
-                lightCircle.setPosition((point.x - halfWidth) * scaleFactor, (point.y - halfWidth) * scaleFactor);
-                renderTexture.draw(lightCircle);
+                return -1.0;
             }
+            ++evaluations;
+            return context.evaluate();
+        };
 
-            // Draw rectangles for the light rays between points
-            for (size_t i = 0; i < pathCurr.points.size() - 1; ++i)
+        for (int round = 0; round < 4; ++round)
+        {
+            bool improved = false;
+
+            // Golden-section search for the angle; the grid winner stays the fallback
+            const double ratio = (std::sqrt(5.0) - 1) / 2;
+            double a = mirror.angle - angleStep, b = mirror.angle + angleStep;
+            double c = b - ratio * (b - a), d = a + ratio * (b - a);
+            double fc = evaluate(mirror.v1, c), fd = evaluate(mirror.v1, d);
+            while (b - a > 1e-6)
             {
-                const Vector2 &p1 = pathCurr.points[i];
-                const Vector2 &p2 = pathCurr.points[i + 1];
-
-                // Calculate the direction vector and its normal
-                Vector2 direction = pathCurr.directions[i];
-                Vector2 normal = {direction.y, -direction.x}; // Rotate 90 degrees to get the normal
-
-                // Normalize the normal vector
-                double length = std::sqrt(normal.x * normal.x + normal.y * normal.y);
-                if (length != 0)
+                if (fc >= fd)
                 {
-                    normal.x /= length;
-                    normal.y /= length;
+                    b = d;
+                    d = c;
+                    fd = fc;
+                    c = b - ratio * (b - a);
+                    fc = evaluate(mirror.v1, c);
                 }
-
-                // Define the rectangle vertices
-                std::vector<sf::Vector2f> vertices = {
-                    {(float)(p1.x - normal.x * halfWidth) * scaleFactor, (float)(p1.y - normal.y * halfWidth) * scaleFactor},
-                    {(float)(p2.x - normal.x * halfWidth) * scaleFactor, (float)(p2.y - normal.y * halfWidth) * scaleFactor},
-                    {(float)(p2.x + normal.x * halfWidth) * scaleFactor, (float)(p2.y + normal.y * halfWidth) * scaleFactor},
-                    {(float)(p1.x + normal.x * halfWidth) * scaleFactor, (float)(p1.y + normal.y * halfWidth) * scaleFactor}};
-
-                // Create a vertex array for the rectangle
-                sf::VertexArray rectangle(sf::Quads, 4);
-                for (size_t j = 0; j < vertices.size(); ++j)
+                else
                 {
-                    rectangle[j].position = vertices[j];
-                    rectangle[j].color = lightColor; // Use the same light color
+                    a = c;
+                    c = d;
+                    fc = fd;
+                    d = a + ratio * (b - a);
+                    fd = evaluate(mirror.v1, d);
                 }
-
-                renderTexture.draw(rectangle); // Draw the rectangle
             }
-
-            if (temple)
+            double angle = fc >= fd ? c : d;
+            double angleScore = std::max(fc, fd);
+            if (angleScore > score)
             {
-                renderTemple(); // Render the temple
+                score = angleScore;
+                mirror.updateMirror(mirror.v1, angle);
+                improved = true;
             }
-            // Capture the current frame of the render texture
-            const sf::Image &image = renderTexture.getTexture().copyToImage();
 
-            unsigned int illuminatedPixelCount = 0;
-            unsigned int emptyPixelCount = 0;
-
-            // Loop through each pixel of the image
-            for (unsigned int x = 0; x < image.getSize().x; ++x)
+            // Compass search of the position
+            const Vector2 moves[4] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+            for (double step = positionStep / 2; step > 1e-3; step /= 2)
             {
-                for (unsigned int y = 0; y < image.getSize().y; ++y)
+                bool moved = true;
+                while (moved)
                 {
-                    sf::Color pixelColor = image.getPixel(x, y);
-
-                    // Check if the pixel is illuminated (i.e., matches the illuminated area color)
-                    // Assuming the illuminated color is a light color (e.g., light orange you used for the illuminated area)
-                    if (pixelColor != sf::Color(229, 222, 178, 255) && pixelColor != sf::Color(128, 122, 120, 255)) // Compare with the exact light color used in drawIlluminatedArea()
-                    {
-                        illuminatedPixelCount++;
-                    }
-                    if (pixelColor == sf::Color(229, 222, 178, 255))
+                    moved = false;
+                    for (const Vector2 &move : moves)
                     {
-                        emptyPixelCount++;
+                        Vector2 v = mirror.v1 + move * step;
+                        double sol = evaluate(v, mirror.angle);
+                        if (sol > score)
+                        {
+                            score = sol;
+                            mirror.updateMirror(v, mirror.angle);
+                            moved = improved = true;
+                        }
                     }
                 }
             }
-            return 100.0 * (double)illuminatedPixelCount / (double)(illuminatedPixelCount + emptyPixelCount);
+
+            if (!improved)
+            {
+                break;
+            }
         }
-        return 0;
+        return score;
     }
 
-    // Method to render the entire temple (with blocks)
-    void renderTemple()
+    // Best lamp pose for the current mirrors (see LampSearch)
+    void findMaxLamp()
     {
-        for (const auto &block : temple->getBlocks())
-        {
-            drawBlock(block, temple->getBlockSize());
-        }
+        LampSearch search(*temple, pool, contexts);
+        LampCandidate best = search.run(mirrors);
+        *lamp = best.lamp;
+        *path = Validation::raytrace(*temple, *lamp, mirrors);
+        printf("Lamp search scored %lld poses\n", search.getEvaluations());
+        lamp->printLampDetails();
     }
 
-    // Method to draw a block (scaled appropriately)
-    void drawBlock(const Block &block, float blockSize)
+    // Percentage of the vacant area illuminated by the path
+    double evaluatePath(const Path &pathCurr)
     {
-        // Create a rectangle shape for the block
-        sf::RectangleShape rectangle;
-        rectangle.setPosition(block.v1.x * scaleFactor, block.v1.y * scaleFactor);         // Position at block's bottom-left vertex
-        rectangle.setSize(sf::Vector2f(blockSize * scaleFactor, blockSize * scaleFactor)); // Set size of the block
-        rectangle.setFillColor(sf::Color(128, 122, 120, 255));                             // Color the blocks white
-
-        // Draw the rectangle on the window
-        renderTexture.draw(rectangle);
+        return scorer.evaluatePath(pathCurr);
     }
 
     void printMirrorPositions() const
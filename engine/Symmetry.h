@@ -0,0 +1,264 @@
+#ifndef SYMMETRY_H
+#define SYMMETRY_H
+
+#include "../math/Vector2.h"
+#include "Temple.h"
+#include "Lamp.h"
+#include "Mirror.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <string>
+#include <vector>
+
+// The symmetry group of the temple's occupancy grid. Candidates are the eight
+// transforms of the square (reflections in both axes, the half turn, and for a
+// square grid also the quarter turns and diagonal reflections); a transform
+// belongs to the group if it maps every block onto a block. The coverage of a
+// solution doesn't change under the group, so symmetric layouts can be
+// identified: canonicalKey gives the same key to all of them, and only lamp
+// positions in the fundamental domain need to be searched.
+class Symmetry {
+public:
+    // A transform of the square: optionally swap x and y, then optionally mirror each axis
+    struct Transform {
+        bool swap;
+        bool flipX;
+        bool flipY;
+
+        bool isIdentity() const {
+            return !swap && !flipX && !flipY;
+        }
+    };
+
+    explicit Symmetry(const Temple& temple) {
+        auto [width, height] = temple.getShape();
+        auto [sizeX, sizeY] = temple.getSize();
+        this->sizeX = sizeX;
+        this->sizeY = sizeY;
+
+        for (int s = 0; s < 2; ++s) {
+            if (s && width != height) {
+                continue;
+            }
+            for (int fx = 0; fx < 2; ++fx) {
+                for (int fy = 0; fy < 2; ++fy) {
+                    Transform transform{s != 0, fx != 0, fy != 0};
+                    if (preservesBlocks(temple, transform)) {
+                        group.push_back(transform);
+                        swaps = swaps || transform.swap;
+                    }
+                }
+            }
+        }
+    }
+
+    // Every transform of the group, the identity first
+    const std::vector<Transform>& getGroup() const {
+        return group;
+    }
+
+    int order() const {
+        return group.size();
+    }
+
+    // E.g. "identity, flip x, flip y, half turn"
+    std::string describe() const {
+        std::string text;
+        for (const Transform& transform : group) {
+            text += (text.empty() ? "" : ", ") + name(transform);
+        }
+        return text;
+    }
+
+    Vector2 apply(const Transform& transform, const Vector2& point) const {
+        Vector2 p = transform.swap ? Vector2(point.y, point.x) : point;
+        if (transform.flipX) {
+            p.x = sizeX - p.x;
+        }
+        if (transform.flipY) {
+            p.y = sizeY - p.y;
+        }
+        return p;
+    }
+
+    // Exact on the identity, so keys of untransformed solutions match plain quantization
+    static double applyToAngle(const Transform& transform, double angle) {
+        if (transform.swap) {
+            angle = M_PI / 2 - angle;
+        }
+        if (transform.flipX) {
+            angle = M_PI - angle;
+        }
+        if (transform.flipY) {
+            angle = -angle;
+        }
+        double wrapped = std::fmod(angle, 2 * M_PI);
+        return wrapped < 0 ? wrapped + 2 * M_PI : wrapped;
+    }
+
+    Lamp apply(const Transform& transform, const Lamp& lamp) const {
+        return Lamp(apply(transform, lamp.v), applyToAngle(transform, lamp.angle));
+    }
+
+    // The image keeps v1 at the image of v1, so the segment is the same one transformed
+    Mirror apply(const Transform& transform, const Mirror& mirror) const {
+        return Mirror(apply(transform, mirror.v1), applyToAngle(transform, mirror.angle), mirror.mirror_length);
+    }
+
+    // Key of a solution that is the same for all its images under the group (and for any
+    // order of its mirrors). Positions are quantized to `position` world units and angles
+    // to `angles` cells per pi; a mirror is keyed by its midpoint and its angle modulo pi.
+    // The solution is quantized once and the group acts on the integer cells, so images
+    // land in exactly the image cells even for values on a cell boundary. That needs the
+    // temple size to be a multiple of `position`. Transforms that swap x and y map angle
+    // cells through pi / 2, so for a group with them an odd `angles` is rounded up.
+    std::vector<long long> canonicalKey(const Lamp& lamp, const std::vector<Mirror>& mirrors,
+                                        double position = 1e-4, int angles = 100000) const {
+        Cells cells = quantize(lamp, mirrors, position, angles);
+        std::vector<long long> best;
+        for (const Transform& transform : group) {
+            std::vector<long long> key = keyOf(transform, cells);
+            if (best.empty() || key < best) {
+                best = std::move(key);
+            }
+        }
+        return best;
+    }
+
+    // Replace the solution with its image of smallest key (the one canonicalKey returns)
+    void canonicalize(Lamp& lamp, std::vector<Mirror>& mirrors, double position = 1e-4, int angles = 100000) const {
+        Cells cells = quantize(lamp, mirrors, position, angles);
+        const Transform* bestTransform = &group.front();
+        std::vector<long long> best;
+        for (const Transform& transform : group) {
+            std::vector<long long> key = keyOf(transform, cells);
+            if (best.empty() || key < best) {
+                best = std::move(key);
+                bestTransform = &transform;
+            }
+        }
+        lamp = apply(*bestTransform, lamp);
+        for (Mirror& mirror : mirrors) {
+            mirror = apply(*bestTransform, mirror);
+        }
+    }
+
+    // True if the point is the representative of its orbit: no image is smaller in (x, y)
+    // order by more than the tolerance. Points on a symmetry axis count for every side, so
+    // the domains of the group tile the temple without gaps.
+    bool inFundamentalDomain(const Vector2& point, double tolerance = 1e-9) const {
+        for (const Transform& transform : group) {
+            Vector2 image = apply(transform, point);
+            if (image.x < point.x - tolerance ||
+                (std::abs(image.x - point.x) <= tolerance && image.y < point.y - tolerance)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    std::vector<Transform> group;
+    bool swaps = false; // Some transform swaps x and y
+    double sizeX = 0;
+    double sizeY = 0;
+
+    static std::string name(const Transform& t) {
+        if (!t.swap) {
+            return t.flipX ? (t.flipY ? "half turn" : "flip x") : (t.flipY ? "flip y" : "identity");
+        }
+        if (t.flipX == t.flipY) {
+            return t.flipX ? "anti-diagonal flip" : "diagonal flip";
+        }
+        return t.flipX ? "quarter turn" : "three-quarter turn";
+    }
+
+    bool preservesBlocks(const Temple& temple, const Transform& transform) const {
+        auto [width, height] = temple.getShape();
+        double cell = temple.getBlockSize();
+        for (int j = 0; j < height; ++j) {
+            for (int i = 0; i < width; ++i) {
+                Vector2 image = apply(transform, Vector2((i + 0.5) * cell, (j + 0.5) * cell));
+                int ti = (int)std::floor(image.x / cell);
+                int tj = (int)std::floor(image.y / cell);
+                if (temple.isBlocked(i, j) != temple.isBlocked(ti, tj)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // A solution quantized under the identity, with the cell counts the group acts on
+    struct Cells {
+        std::array<long long, 3> lamp;
+        std::vector<std::array<long long, 3>> mirrors;
+        long long columns;      // Position cells across the temple
+        long long rows;
+        long long angleCells;   // Angle cells per pi, for the mirrors (period pi) and the lamp (period 2 pi)
+    };
+
+    static long long quantizeAngle(double angle, double period, long long cells) {
+        double wrapped = std::fmod(angle, period);
+        if (wrapped < 0) {
+            wrapped += period;
+        }
+        return std::llround(wrapped / period * cells) % cells;
+    }
+
+    static long long wrapCell(long long cell, long long cells) {
+        return ((cell % cells) + cells) % cells;
+    }
+
+    Cells quantize(const Lamp& lamp, const std::vector<Mirror>& mirrors, double position, int angles) const {
+        Cells cells;
+        cells.columns = std::llround(sizeX / position);
+        cells.rows = std::llround(sizeY / position);
+        cells.angleCells = swaps && angles % 2 ? angles + 1 : angles;
+        cells.lamp = {std::llround(lamp.v.x / position), std::llround(lamp.v.y / position),
+                      quantizeAngle(lamp.angle, 2 * M_PI, 2 * cells.angleCells)};
+        for (const Mirror& mirror : mirrors) {
+            Vector2 middle = (mirror.v1 + mirror.v2) * 0.5;
+            cells.mirrors.push_back({std::llround(middle.x / position), std::llround(middle.y / position),
+                                     quantizeAngle(mirror.angle, M_PI, cells.angleCells)});
+        }
+        return cells;
+    }
+
+    // The cells of a position and an angle under a transform; `pi` is the angle cell count
+    // of pi (even if the transform swaps) and `period` that of the angle's period
+    static std::array<long long, 3> transformCell(const Transform& t, std::array<long long, 3> c, long long columns,
+                                                  long long rows, long long pi, long long period) {
+        if (t.swap) {
+            c = {c[1], c[0], pi / 2 - c[2]};
+        }
+        if (t.flipX) {
+            c[0] = columns - c[0];
+            c[2] = pi - c[2];
+        }
+        if (t.flipY) {
+            c[1] = rows - c[1];
+            c[2] = -c[2];
+        }
+        c[2] = wrapCell(c[2], period);
+        return c;
+    }
+
+    std::vector<long long> keyOf(const Transform& transform, const Cells& cells) const {
+        const long long a = cells.angleCells;
+        std::array<long long, 3> lamp = transformCell(transform, cells.lamp, cells.columns, cells.rows, a, 2 * a);
+        std::vector<long long> key(lamp.begin(), lamp.end());
+        std::vector<std::array<long long, 3>> mirrorKeys;
+        for (const std::array<long long, 3>& mirror : cells.mirrors) {
+            mirrorKeys.push_back(transformCell(transform, mirror, cells.columns, cells.rows, a, a));
+        }
+        std::sort(mirrorKeys.begin(), mirrorKeys.end());
+        for (const std::array<long long, 3>& mirrorKey : mirrorKeys) {
+            key.insert(key.end(), mirrorKey.begin(), mirrorKey.end());
+        }
+        return key;
+    }
+};
+
+#endif // SYMMETRY_H
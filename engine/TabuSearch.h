@@ -0,0 +1,282 @@
+#ifndef TABU_SEARCH_H
+#define TABU_SEARCH_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iterator>
+#include <unordered_map>
+#include <vector>
+#include "../math/Vector2.h"
+#include "Temple.h"
+#include "Lamp.h"
+#include "Mirror.h"
+#include "Validation.h"
+#include "SolutionSpace.h"
+#include "ScoringContext.h"
+#include "ThreadPool.h"
+#include "Repair.h"
+
+struct TabuOptions
+{
+    double positionStep = 0.01;        // Lattice spacing of positions, in world units...
+    int angleSteps = 3600;             // ...and of angles, as steps per full turn
+    std::vector<int> moveSizes{1, 4, 16, 64}; // A move shifts one coordinate by this many lattice steps either way
+    int tenure = 40;                   // Iterations a pose just left stays tabu
+    int restartAfter = 200;            // Iterations without a new best before going back to the best solution
+    double seconds = 60;               // Wall-clock budget
+    long long maxIterations = -1;      // Also stop after this many iterations (< 0 for no limit)
+    int reportEvery = 50;              // Progress line every this many iterations (0 for none)
+};
+
+// Tabu search on a lattice of poses. Every element (the lamp and each mirror)
+// moves on a lattice anchored at its starting pose: positions in steps of
+// positionStep and angles in steps of a full turn over angleSteps. A move shifts
+// one coordinate of one element by one of the move sizes, up or down; all moves
+// that keep the solution valid form the neighbourhood, which is scored in
+// parallel, one scoring context per worker.
+//
+// Each iteration takes the best neighbour even when it is worse than the
+// current solution, which walks the search out of local optima. To keep it from
+// walking straight back, the pose an element leaves becomes tabu for `tenure`
+// iterations: the tabu list is a hash map from (element, lattice pose) to the
+// iteration it expires. The aspiration criterion lifts the ban for a move that
+// beats the best score found so far. When the best hasn't improved for
+// restartAfter iterations, the search intensifies: it goes back to the best
+// solution and starts with a fresh tabu list. The best neighbour is chosen
+// serially, the first in move order on ties, so runs don't depend on the
+// thread count.
+class TabuSearch
+{
+public:
+    TabuSearch(const Temple &temple, ThreadPool &pool, std::vector<ScoringContext> &contexts,
+               const TabuOptions &options = TabuOptions())
+        : temple(temple), pool(pool), contexts(contexts), options(options)
+    {
+    }
+
+    // Search from the given (valid) solution. Returns the best score and leaves the best
+    // solution in lamp and mirrors.
+    double run(Lamp &lamp, std::vector<Mirror> &mirrors)
+    {
+        Lamp currentLamp = lamp;
+        std::vector<Mirror> currentMirrors = mirrors;
+        ScoringContext &context = contexts.front();
+        context.lamp = lamp;
+        context.mirrors = mirrors;
+        double current = context.evaluate();
+        double best = current;
+        tabu.clear();
+
+        auto start = std::chrono::steady_clock::now();
+        long long iteration = 0;
+        int aspirations = 0;
+        int restarts = 0;
+        long long sinceBest = 0;
+        std::vector<Move> moves;
+        for (; options.maxIterations < 0 || iteration < options.maxIterations; ++iteration)
+        {
+            if (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= options.seconds)
+            {
+                break;
+            }
+
+            neighbourhood(currentLamp, currentMirrors, moves);
+            pool.parallelFor(moves.size(), [&](int worker, size_t i)
+                             {
+                ScoringContext &context = contexts[worker];
+                context.lamp = currentLamp;
+                context.mirrors = currentMirrors;
+                place(moves[i], context.lamp, context.mirrors);
+                moves[i].score = context.evaluate(); });
+
+            // Best admissible move: not tabu, or better than anything found so far
+            int chosen = -1;
+            bool aspirated = false;
+            for (int i = 0; i < (int)moves.size(); ++i)
+            {
+                bool isTabu = isTabuPose(moves[i].element, moves[i].position, moves[i].angle, iteration);
+                if (isTabu && moves[i].score <= best)
+                {
+                    continue;
+                }
+                if (chosen < 0 || moves[i].score > moves[chosen].score)
+                {
+                    chosen = i;
+                    aspirated = isTabu;
+                }
+            }
+            if (chosen < 0)
+            {
+                printf("Tabu search: every move is tabu after %lld iterations\n", iteration);
+                break;
+            }
+            aspirations += aspirated;
+
+            // The pose the element leaves becomes tabu
+            const Move &move = moves[chosen];
+            if (move.element == 0)
+            {
+                makeTabu(0, currentLamp.v, currentLamp.angle, iteration);
+            }
+            else
+            {
+                const Mirror &left = currentMirrors[move.element - 1];
+                makeTabu(move.element, left.v1, left.angle, iteration);
+            }
+            place(move, currentLamp, currentMirrors);
+            current = move.score;
+
+            if (current > best)
+            {
+                best = current;
+                lamp = currentLamp;
+                mirrors = currentMirrors;
+                sinceBest = 0;
+            }
+            else if (++sinceBest >= options.restartAfter)
+            {
+                currentLamp = lamp;
+                currentMirrors = mirrors;
+                current = best;
+                tabu.clear();
+                sinceBest = 0;
+                ++restarts;
+            }
+            if (options.reportEvery > 0 && (iteration + 1) % options.reportEvery == 0)
+            {
+                printf("Iteration %lld: current = %.4f, best = %.4f, %zu neighbours, %zu tabu poses\n", iteration + 1,
+                       current, best, moves.size(), tabu.size());
+            }
+        }
+
+        printf("Tabu search finished after %lld iterations: best = %.4f, %d aspirations, %d restarts\n", iteration, best,
+               aspirations, restarts);
+        return best;
+    }
+
+private:
+    // One neighbour: the new pose of one element (0 is the lamp, i > 0 mirror i - 1)
+    struct Move
+    {
+        int element;
+        Vector2 position;
+        double angle;
+        double score;
+    };
+
+    const Temple &temple;
+    ThreadPool &pool;
+    std::vector<ScoringContext> &contexts;
+    TabuOptions options;
+    std::unordered_map<unsigned long long, long long> tabu; // Pose key -> iteration the ban ends
+
+    static void place(const Move &move, Lamp &lamp, std::vector<Mirror> &mirrors)
+    {
+        if (move.element == 0)
+        {
+            lamp.updateLamp(move.position, move.angle);
+        }
+        else
+        {
+            mirrors[move.element - 1].updateMirror(move.position, move.angle);
+        }
+    }
+
+    // Every lattice move that keeps the solution valid, in a fixed order
+    void neighbourhood(const Lamp &lamp, const std::vector<Mirror> &mirrors, std::vector<Move> &moves) const
+    {
+        moves.clear();
+        const double angleStep = 2 * M_PI / options.angleSteps;
+        for (int element = 0; element <= (int)mirrors.size(); ++element)
+        {
+            Vector2 position = element == 0 ? lamp.v : mirrors[element - 1].v1;
+            double angle = element == 0 ? lamp.angle : mirrors[element - 1].angle;
+            for (int coordinate = 0; coordinate < 3; ++coordinate)
+            {
+                for (int size : options.moveSizes)
+                {
+                    for (int sign = -1; sign <= 1; sign += 2)
+                    {
+                        Move move{element, position, angle, 0};
+                        if (coordinate == 0)
+                        {
+                            move.position.x += sign * size * options.positionStep;
+                        }
+                        else if (coordinate == 1)
+                        {
+                            move.position.y += sign * size * options.positionStep;
+                        }
+                        else
+                        {
+                            move.angle = SolutionSpace::wrapAngle(angle + sign * size * angleStep);
+                        }
+                        if (valid(move, mirrors))
+                        {
+                            moves.push_back(move);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // check_solution's tests for the moved element
+    bool valid(const Move &move, const std::vector<Mirror> &mirrors) const
+    {
+        if (move.element == 0)
+        {
+            return Repair::lampFeasible(temple, move.position);
+        }
+        Mirror mirror = mirrors[move.element - 1];
+        mirror.updateMirror(move.position, move.angle);
+        if (!Repair::mirrorFeasible(temple, mirror))
+        {
+            return false;
+        }
+        for (size_t i = 0; i < mirrors.size(); ++i)
+        {
+            if ((int)i != move.element - 1 && Validation::segment_segment_intersection(mirror.s, mirrors[i].s))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Hash of an element's pose on the lattice
+    unsigned long long poseKey(int element, const Vector2 &position, double angle) const
+    {
+        long long cells[4] = {element, std::llround(position.x / options.positionStep),
+                              std::llround(position.y / options.positionStep),
+                              std::llround(angle / (2 * M_PI) * options.angleSteps) % options.angleSteps};
+        unsigned long long hash = 14695981039346656037ULL;
+        for (long long cell : cells)
+        {
+            hash = (hash ^ (unsigned long long)cell) * 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    bool isTabuPose(int element, const Vector2 &position, double angle, long long iteration) const
+    {
+        auto found = tabu.find(poseKey(element, position, angle));
+        return found != tabu.end() && found->second > iteration;
+    }
+
+    void makeTabu(int element, const Vector2 &position, double angle, long long iteration)
+    {
+        tabu[poseKey(element, position, angle)] = iteration + options.tenure;
+        // Drop expired entries now and then so the map stays small
+        if (tabu.size() > 64 * (size_t)options.tenure)
+        {
+            for (auto entry = tabu.begin(); entry != tabu.end();)
+            {
+                entry = entry->second <= iteration ? tabu.erase(entry) : std::next(entry);
+            }
+        }
+    }
+};
+
+#endif // TABU_SEARCH_H
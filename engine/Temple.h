@@ -8,6 +8,9 @@
 #include <vector>
 #include <cmath>
 #include <tuple>
+#include "ProblemSpec.h"
+#include "OccupancyPyramid.h"
+#include "TempleLayout.h"
 
 struct Block {
     // Vertices
@@ -22,33 +25,32 @@ struct Block {
     }
 };
 
+// The competition temple, parsed at compile time
+namespace cmc24 {
+static_assert(templelayout::isRectangular(cmc24TempleString), "The CMC24 temple rows aren't of equal length.");
+inline constexpr int templeWidth = templelayout::width(cmc24TempleString);
+inline constexpr int templeHeight = templelayout::height(cmc24TempleString);
+inline constexpr auto templeOccupancy = templelayout::parse<templeWidth, templeHeight>(cmc24TempleString);
+inline constexpr int templeWallCount = templelayout::collectWalls(templeOccupancy, nullptr);
+inline constexpr auto templeWalls = templelayout::walls<templeWallCount>(templeOccupancy);
+static_assert(templeWidth == 20 && templeHeight == 20, "The CMC24 temple is 20x20 blocks.");
+} // namespace cmc24
+
 class Temple {
 public:
-    Temple() {
-        // Initialize the temple_string
-        temple_string =
-            "O  O  O  O  O  O  O  O  O  O  O  O  O  O  O  O  O  O  O  O\n"
-            "O  .  .  .  .  O  .  .  .  .  .  .  .  .  O  .  .  .  .  O\n"
-            "O  .  .  .  .  .  .  .  O  .  .  O  .  .  .  .  .  .  .  O\n"
-            "O  .  .  .  .  .  O  .  .  .  .  .  .  O  .  .  .  .  .  O\n"
-            "O  .  .  O  .  .  .  .  .  O  O  .  .  .  .  .  O  .  .  O\n"
-            "O  O  .  .  .  .  .  .  .  O  O  .  .  .  .  .  .  .  O  O\n"
-            "O  .  .  .  O  .  .  .  .  .  .  .  .  .  .  O  .  .  .  O\n"
-            "O  .  .  .  .  .  .  O  .  .  .  .  O  .  .  .  .  .  .  O\n"
-            "O  .  .  .  .  .  .  .  .  O  O  .  .  .  .  .  .  .  .  O\n"
-            "O  .  O  .  .  O  O  .  .  .  .  .  .  O  O  .  .  O  .  O\n"
-            "O  .  O  .  .  O  O  .  .  .  .  .  .  O  O  .  .  O  .  O\n"
-            "O  .  .  .  .  .  .  .  .  O  O  .  .  .  .  .  .  .  .  O\n"
-            "O  .  .  .  .  .  .  O  .  .  .  .  O  .  .  .  .  .  .  O\n"
-            "O  .  .  .  O  .  .  .  .  .  .  .  .  .  .  O  .  .  .  O\n"
-            "O  O  .  .  .  .  .  .  .  O  O  .  .  .  .  .  .  .  O  O\n"
-            "O  .  .  O  .  .  .  .  .  O  O  .  .  .  .  .  O  .  .  O\n"
-            "O  .  .  .  .  .  O  .  .  .  .  .  .  O  .  .  .  .  .  O\n"
-            "O  .  .  .  .  .  .  .  O  .  .  O  .  .  .  .  .  .  .  O\n"
-            "O  .  .  .  .  O  .  .  .  .  .  .  .  .  O  .  .  .  .  O\n"
-            "O  O  O  O  O  O  O  O  O  O  O  O  O  O  O  O  O  O  O  O";
-        block_size = 1;
-        loadTemple();
+    // The official CMC24 temple
+    Temple() : Temple(ProblemSpec()) {}
+
+    // Compile a problem spec into the temple geometry used by the tracer and the scorer.
+    // The CMC24 layout comes precompiled, any other layout is parsed at runtime.
+    explicit Temple(const ProblemSpec& problemSpec) : spec(problemSpec) {
+        temple_string = spec.temple_string;
+        block_size = spec.block_size;
+        if (temple_string == cmc24TempleString) {
+            loadCompiledTemple(cmc24::templeOccupancy, cmc24::templeWalls);
+        } else {
+            loadTemple();
+        }
     }
 
     void printTempleString() const {
@@ -59,33 +61,84 @@ public:
         return block_size; // Getter for block_size
     }
 
+    const ProblemSpec& getSpec() const {
+        return spec;
+    }
+
     const std::set<Block>& getBlocks() const {
         return blocks;
     }
 
+    // Block sides that face a vacant cell (or the outside), merged into maximal straight runs
+    const std::vector<std::tuple<Vector2, double, double>>& getWalls() const {
+        return walls;
+    }
+
+    // Hierarchical occupancy for ray traversal and coverage counting on large temples
+    const OccupancyPyramid& getPyramid() const {
+        return pyramid;
+    }
+
+    // Size of the temple in world units
     std::pair<int, int> getSize() const {
-        return {temple_width, temple_height}; // Return width and height
+        return {temple_width * block_size, temple_height * block_size}; // Return width and height
+    }
+
+    // Size of the temple in cells
+    std::pair<int, int> getShape() const {
+        return {temple_width, temple_height};
+    }
+
+    // Cell (i, j) counts columns from the left and rows from the bottom
+    bool isBlocked(int i, int j) const {
+        if (i < 0 || j < 0 || i >= temple_width || j >= temple_height) {
+            return false;
+        }
+        return occupancy[j * temple_width + i] != 0;
     }
 
-    
+    // True if the point lies inside or on the boundary of any block
+    bool pointInBlock(const Vector2& point) const {
+        double cx = point.x / block_size;
+        double cy = point.y / block_size;
+        int i = static_cast<int>(std::floor(cx));
+        int j = static_cast<int>(std::floor(cy));
+
+        // A point exactly on a cell edge touches the cells on both sides of it
+        int i0 = (cx == i) ? i - 1 : i;
+        int j0 = (cy == j) ? j - 1 : j;
+        for (int jj = j0; jj <= j; ++jj) {
+            for (int ii = i0; ii <= i; ++ii) {
+                if (isBlocked(ii, jj)) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
 
 private:
+    ProblemSpec spec;
     std::string temple_string;
     int block_size;
     int temple_height;
     int temple_width;
     std::set<Block> blocks;
+    std::vector<unsigned char> occupancy; // temple_width * temple_height, row 0 at the bottom
+    std::vector<std::tuple<Vector2, double, double>> walls;
+    OccupancyPyramid pyramid;
 
     // Function to load the temple and store blocks
     void loadTemple() {
-        blocks.clear();
         std::vector<std::string> rows;
         std::string temp_row;
         for (char c : temple_string) {
             if (c == '\n') {
-                rows.push_back(temp_row);
+                if (!temp_row.empty()) {
+                    rows.push_back(temp_row);
+                }
                 temp_row.clear();
-            } else if (c != ' ') {
+            } else if (c != ' ' && c != '\r' && c != '\t') {
                 temp_row.push_back(c);
             }
         }
@@ -94,13 +147,62 @@ private:
         }
 
         temple_height = rows.size();
-        temple_width = !rows.empty() ? rows[0].size() : 0; // Assumes temple_string is formatted properly
+        temple_width = !rows.empty() ? rows[0].size() : 0;
+        for (const std::string& row : rows) {
+            if ((int)row.size() != temple_width) {
+                std::cerr << "ERROR! The temple rows aren't of equal length." << std::endl;
+                break;
+            }
+        }
 
+        occupancy.assign(temple_width * temple_height, 0);
         for (int j = 0; j < temple_height; ++j) {
-            for (int i = 0; i < temple_width; ++i) {
+            for (int i = 0; i < temple_width && i < (int)rows[j].size(); ++i) {
                 if (rows[j][i] == 'O') {
+                    occupancy[(temple_height - j - 1) * temple_width + i] = 1;
+                }
+            }
+        }
+
+        buildBlocks();
+        buildWalls();
+        pyramid.build(occupancy, temple_width, temple_height, block_size);
+
+        std::cerr << "The temple of size (" << temple_width << ", " << temple_height << ") is loaded." << std::endl;
+    }
+
+    // Take the occupancy and walls from a layout parsed at compile time
+    template <int Width, int Height, size_t WallCount>
+    void loadCompiledTemple(const templelayout::Occupancy<Width, Height>& layout,
+                            const std::array<templelayout::GridWall, WallCount>& gridWalls) {
+        temple_width = Width;
+        temple_height = Height;
+
+        occupancy.assign(Width * Height, 0);
+        for (int j = 0; j < Height; ++j) {
+            for (int i = 0; i < Width; ++i) {
+                occupancy[j * Width + i] = layout.isBlocked(i, j);
+            }
+        }
+
+        buildBlocks();
+        walls.clear();
+        walls.reserve(WallCount);
+        for (const templelayout::GridWall& wall : gridWalls) {
+            walls.emplace_back(Vector2(wall.x * block_size, wall.y * block_size), wall.length * block_size,
+                               wall.vertical ? M_PI / 2 : 0.0);
+        }
+        pyramid.build(occupancy, temple_width, temple_height, block_size);
+    }
+
+    // Create the block set (used for drawing) from the occupancy grid
+    void buildBlocks() {
+        blocks.clear();
+        for (int j = 0; j < temple_height; ++j) {
+            for (int i = 0; i < temple_width; ++i) {
+                if (isBlocked(i, j)) {
                     int x = i * block_size;
-                    int y = (temple_height - j - 1) * block_size;
+                    int y = j * block_size;
 
                     // Define block vertices using Vector2
                     Vector2 v1(x, y);                          // Bottom-left
@@ -122,8 +224,41 @@ private:
                 }
             }
         }
+    }
 
-        std::cerr << "The temple of size (" << temple_width << ", " << temple_height << ") is loaded." << std::endl;
+    // A side shared by two blocks can never be the first thing a ray from free space hits,
+    // so only sides between a block and a vacant cell (or the outside) are kept, and
+    // consecutive ones on the same line are merged into a single wall.
+    void buildWalls() {
+        walls.clear();
+
+        // Horizontal walls on the grid line y = j
+        for (int j = 0; j <= temple_height; ++j) {
+            int start = -1;
+            for (int i = 0; i <= temple_width; ++i) {
+                bool exposed = i < temple_width && isBlocked(i, j) != isBlocked(i, j - 1);
+                if (exposed && start < 0) {
+                    start = i;
+                } else if (!exposed && start >= 0) {
+                    walls.emplace_back(Vector2(start * block_size, j * block_size), (i - start) * block_size, 0.0);
+                    start = -1;
+                }
+            }
+        }
+
+        // Vertical walls on the grid line x = i
+        for (int i = 0; i <= temple_width; ++i) {
+            int start = -1;
+            for (int j = 0; j <= temple_height; ++j) {
+                bool exposed = j < temple_height && isBlocked(i, j) != isBlocked(i - 1, j);
+                if (exposed && start < 0) {
+                    start = j;
+                } else if (!exposed && start >= 0) {
+                    walls.emplace_back(Vector2(i * block_size, start * block_size), (j - start) * block_size, M_PI / 2);
+                    start = -1;
+                }
+            }
+        }
     }
 };
 
@@ -0,0 +1,170 @@
+#ifndef TEMPLE_LAYOUT_H
+#define TEMPLE_LAYOUT_H
+
+#include <array>
+#include <cstdint>
+
+// Compile-time parsing of a temple layout literal ('O' = block, any other
+// non-space character = vacant, one row per line, top row first). A fixed
+// temple becomes a constexpr occupancy bitmask and wall list, so nothing is
+// parsed at startup and the dimensions are compile-time constants.
+namespace templelayout {
+
+constexpr bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Number of cells in the first non-empty row
+constexpr int width(const char* layout) {
+    int count = 0;
+    for (const char* c = layout; *c; ++c) {
+        if (*c == '\n') {
+            if (count > 0) {
+                return count;
+            }
+        } else if (!isSpace(*c)) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+// Number of non-empty rows
+constexpr int height(const char* layout) {
+    int rows = 0;
+    bool rowHasCells = false;
+    for (const char* c = layout; *c; ++c) {
+        if (*c == '\n') {
+            rows += rowHasCells;
+            rowHasCells = false;
+        } else if (!isSpace(*c)) {
+            rowHasCells = true;
+        }
+    }
+    return rows + rowHasCells;
+}
+
+// True if every non-empty row has the same number of cells
+constexpr bool isRectangular(const char* layout) {
+    int expected = width(layout);
+    int count = 0;
+    for (const char* c = layout;; ++c) {
+        if (*c == '\n' || *c == '\0') {
+            if (count != 0 && count != expected) {
+                return false;
+            }
+            count = 0;
+            if (*c == '\0') {
+                return true;
+            }
+        } else if (!isSpace(*c)) {
+            ++count;
+        }
+    }
+}
+
+// A wall on the cell grid: `length` cells starting at grid point (x, y)
+struct GridWall {
+    int x = 0;
+    int y = 0;
+    int length = 0;
+    bool vertical = false;
+};
+
+template <int Width, int Height>
+struct Occupancy {
+    static constexpr int width = Width;
+    static constexpr int height = Height;
+
+    std::array<std::uint64_t, (Width * Height + 63) / 64> bits{};
+
+    // Cell (i, j) counts columns from the left and rows from the bottom
+    constexpr bool isBlocked(int i, int j) const {
+        if (i < 0 || j < 0 || i >= Width || j >= Height) {
+            return false;
+        }
+        int bit = j * Width + i;
+        return (bits[bit / 64] >> (bit % 64)) & 1;
+    }
+
+    constexpr int blockCount() const {
+        int count = 0;
+        for (int j = 0; j < Height; ++j) {
+            for (int i = 0; i < Width; ++i) {
+                count += isBlocked(i, j);
+            }
+        }
+        return count;
+    }
+};
+
+template <int Width, int Height>
+constexpr Occupancy<Width, Height> parse(const char* layout) {
+    Occupancy<Width, Height> occupancy{};
+    int i = 0;
+    int row = 0; // From the top
+    for (const char* c = layout; *c; ++c) {
+        if (*c == '\n') {
+            if (i > 0) {
+                ++row;
+            }
+            i = 0;
+        } else if (!isSpace(*c)) {
+            if (*c == 'O' && i < Width && row < Height) {
+                int bit = (Height - row - 1) * Width + i;
+                occupancy.bits[bit / 64] |= std::uint64_t(1) << (bit % 64);
+            }
+            ++i;
+        }
+    }
+    return occupancy;
+}
+
+// Same walls as Temple::buildWalls: maximal runs of block sides next to a vacant
+// cell or the outside. With `out` == nullptr only counts them.
+template <int Width, int Height>
+constexpr int collectWalls(const Occupancy<Width, Height>& occupancy, GridWall* out) {
+    int count = 0;
+    for (int j = 0; j <= Height; ++j) {
+        int start = -1;
+        for (int i = 0; i <= Width; ++i) {
+            bool exposed = i < Width && occupancy.isBlocked(i, j) != occupancy.isBlocked(i, j - 1);
+            if (exposed && start < 0) {
+                start = i;
+            } else if (!exposed && start >= 0) {
+                if (out) {
+                    out[count] = GridWall{start, j, i - start, false};
+                }
+                ++count;
+                start = -1;
+            }
+        }
+    }
+    for (int i = 0; i <= Width; ++i) {
+        int start = -1;
+        for (int j = 0; j <= Height; ++j) {
+            bool exposed = j < Height && occupancy.isBlocked(i, j) != occupancy.isBlocked(i - 1, j);
+            if (exposed && start < 0) {
+                start = j;
+            } else if (!exposed && start >= 0) {
+                if (out) {
+                    out[count] = GridWall{i, start, j - start, true};
+                }
+                ++count;
+                start = -1;
+            }
+        }
+    }
+    return count;
+}
+
+template <int Count, int Width, int Height>
+constexpr std::array<GridWall, Count> walls(const Occupancy<Width, Height>& occupancy) {
+    std::array<GridWall, Count> result{};
+    collectWalls(occupancy, &result[0]);
+    return result;
+}
+
+} // namespace templelayout
+
+#endif // TEMPLE_LAYOUT_H
@@ -0,0 +1,138 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for data-parallel loops. The calling thread takes
+// part as worker 0, so a pool of size 1 runs everything inline. Every worker has
+// a stable id in [0, size()), which solvers use to pick their own scoring context.
+class ThreadPool
+{
+public:
+    // threads == 0 uses one worker per hardware thread
+    explicit ThreadPool(int threads = 0)
+    {
+        if (threads <= 0)
+        {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        for (int id = 1; id < threads; ++id)
+        {
+            workers.emplace_back([this, id]
+                                 { workerLoop(id); });
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread &worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    int size() const
+    {
+        return workers.size() + 1;
+    }
+
+    // Call body(worker, index) for every index in [0, count) and wait until all calls returned
+    void parallelFor(size_t count, const std::function<void(int, size_t)> &body)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+        if (workers.empty() || count == 1)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                body(0, i);
+            }
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &body;
+            jobSize = count;
+            next = 0;
+            busy = workers.size();
+            ++generation;
+        }
+        wake.notify_all();
+
+        runJob(0, body, count);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]
+                  { return busy == 0; });
+        job = nullptr;
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(int, size_t)> *job = nullptr;
+    size_t jobSize = 0;
+    std::atomic<size_t> next{0};
+    size_t busy = 0;
+    unsigned long generation = 0;
+    bool stopping = false;
+
+    void runJob(int worker, const std::function<void(int, size_t)> &body, size_t count)
+    {
+        for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1))
+        {
+            body(worker, i);
+        }
+    }
+
+    void workerLoop(int id)
+    {
+        unsigned long seen = 0;
+        while (true)
+        {
+            const std::function<void(int, size_t)> *body;
+            size_t count;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&]
+                          { return stopping || generation != seen; });
+                if (stopping)
+                {
+                    return;
+                }
+                seen = generation;
+                body = job;
+                count = jobSize;
+            }
+
+            runJob(id, *body, count);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                --busy;
+            }
+            done.notify_one();
+        }
+    }
+};
+
+#endif // THREAD_POOL_H
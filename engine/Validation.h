@@ -2,7 +2,12 @@
 #define VALIDATION_H
 
 #include "../math/Vector2.h"
+#include "../math/Predicates.h"
 #include "Temple.h"
+#include "Lamp.h"
+#include "Mirror.h"
+#include "MirrorBVH.h"
+#include <algorithm>
 #include <vector>
 #include <cmath>
 #include <limits>
@@ -21,24 +26,32 @@ struct Path {
     std::vector<Vector2> directions;
 };
 
+// What ended each segment of a traced path: the index of the mirror hit (-1 for the
+// temple) and the ray parameter of the hit, for tracers that reuse a path prefix
+struct TraceHits {
+    std::vector<int> mirrors;
+    std::vector<double> params;
+};
+
 class Validation {
 public:
     // Function to check if a given point is inside any block in the temple
     static bool pointInBlock(const Temple& temple, const Vector2& point) {
-        for (const Block& block : temple.getBlocks()) {
-            // Check if the point is within the bottom-left (v1) and top-right (v3) corners of the block
-            if (isWithinBlock(block, point)) {
-                return true;
-            }
-        }
-        return false;
+        // The occupancy grid answers this with at most four cell lookups
+        return temple.pointInBlock(point);
     }
 
-    // Function to load the solution and return a bool indicating success/failure
-    static bool load_solution(const std::vector<std::vector<double>>& cmc24_solution, Lamp& lamp, std::vector<Mirror>& mirrors, double mirror_length = 0.5) {
-        // Check if the solution is 9x3
-        if (cmc24_solution.size() != 9 || cmc24_solution[0].size() != 3) {
-            std::cerr << "ERROR! The solution isn't a 9x3 size matrix." << std::endl;
+    // Function to load the solution and return a bool indicating success/failure.
+    // The solution has one row for the lamp and one per mirror, each as (x, y, angle).
+    static bool load_solution(const std::vector<std::vector<double>>& cmc24_solution, Lamp& lamp, std::vector<Mirror>& mirrors, const ProblemSpec& spec = ProblemSpec()) {
+        // Check if the solution is (mirror_count + 1)x3
+        size_t rows = spec.mirror_count + 1;
+        bool shapeOk = cmc24_solution.size() == rows;
+        for (size_t m = 0; shapeOk && m < rows; ++m) {
+            shapeOk = cmc24_solution[m].size() == 3;
+        }
+        if (!shapeOk) {
+            std::cerr << "ERROR! The solution isn't a " << rows << "x3 size matrix." << std::endl;
             return false;
         }
 
@@ -51,12 +64,12 @@ public:
         mirrors.clear();
 
         // Preprocess the mirrors
-        for (int m = 1; m <= 8; ++m) {
+        for (size_t m = 1; m < rows; ++m) {
             Vector2 mirrorPosition = {cmc24_solution[m][0], cmc24_solution[m][1]};
             double mirrorDirection = cmc24_solution[m][2];
 
             // Update or add a new mirror to the list
-            Mirror mirror(mirrorPosition, mirrorDirection, mirror_length);
+            Mirror mirror(mirrorPosition, mirrorDirection, spec.mirror_length);
             mirrors.push_back(mirror);
         }
 
@@ -64,33 +77,37 @@ public:
         return true;
     }
 
-    // Ray-Ray intersection function
+    // Ray-Ray intersection function. Which case applies, and how t and u compare with 0 and 1,
+    // is decided with exact predicates, so grazing hits on corners don't depend on rounding.
     static std::tuple<int, double, double> ray_ray_intersection(const Ray& ray1, const Ray& ray2) {
         Vector2 p = ray1.origin;
         Vector2 r = ray1.direction;
         Vector2 q = ray2.origin;
         Vector2 s = ray2.direction;
 
-        double rs = r.cross(s);         // Cross product of r and s
-        double qpr = (q - p).cross(r);  // Cross product of (q - p) and r
+        int rsSign = Predicates::crossSign(r, s);          // Sign of the cross product of r and s
+        int qprSign = Predicates::diffCrossSign(q, p, r);  // Sign of the cross product of (q - p) and r
 
         // CASE 1 - Rays are collinear and maybe overlap
-        if (rs == 0 && qpr == 0) {
+        if (rsSign == 0 && qprSign == 0) {
             double t0 = (q - p)*r / (r*r);
             double t1 = (q + s - p)*r / (r*r);
             return {1, t0, t1};
         }
 
         // CASE 2 - Rays are parallel but do not intersect
-        if (rs == 0 && qpr != 0) {
+        if (rsSign == 0) {
             return {2, 0, 0};
         }
 
         // CASE 3 - Rays intersect
-        double qps = (q - p).cross(s);
-        double t = qps / rs;
-        double u = qpr / rs;
-        if (rs != 0 && t >= 0 && u >= 0) {
+        double rs = r.cross(s);
+        int qpsSign = Predicates::diffCrossSign(q, p, s);
+        double t = Predicates::consistentRatio((q - p).cross(s) / rs, qpsSign * rsSign,
+                                               -Predicates::crossMinusDiffCrossSign(r, s, q, p, s) * rsSign);
+        double u = Predicates::consistentRatio((q - p).cross(r) / rs, qprSign * rsSign,
+                                               -Predicates::crossMinusDiffCrossSign(r, s, q, p, r) * rsSign);
+        if (t >= 0 && u >= 0) {
             return {3, t, u};
         }
 
@@ -100,14 +117,12 @@ public:
 
     // Ray-Segment intersection function
     static std::tuple<int, double, double> ray_segment_intersection(const Ray& ray, const std::tuple<Vector2, double, double>& segment) {
-        Vector2 p = ray.origin;
-        Vector2 r = ray.direction;
         Vector2 q = std::get<0>(segment);  // Vertex of the segment
         double l = std::get<1>(segment);      // Length of the segment
         double beta = std::get<2>(segment); // Angle of the segment
 
         // Compute the direction vector of the segment
-        Vector2 s = {l * cos(beta), l * sin(beta)};
+        Vector2 s = Predicates::segmentVector(l, beta);
 
         // Call the ray-ray intersection function
         auto [caseType, t, u] = ray_ray_intersection(ray, Ray(q, s));
@@ -143,8 +158,8 @@ public:
         double beta = std::get<2>(segment2);  // Angle of segment2
 
         // Compute the direction vectors for both segments
-        Vector2 r = Vector2(std::cos(alpha), std::sin(alpha)) * la;
-        Vector2 s = Vector2(std::cos(beta), std::sin(beta)) * lb;
+        Vector2 r = Predicates::segmentVector(la, alpha);
+        Vector2 s = Predicates::segmentVector(lb, beta);
 
         // Use ray-ray intersection helper function
         auto [caseType, t, u] = ray_ray_intersection(Ray(p, r), Ray(q, s));
@@ -186,9 +201,10 @@ public:
 
     // Temple-Segment intersection function
     static bool temple_segment_intersection(const Temple& temple, const std::tuple<Vector2, double, double>& segment) {
-        // Iterate over each block in the temple and check for intersections
-        for (const Block& block : temple.getBlocks()) {
-            if (segment_block_intersection(segment, block)) {
+        // Check the segment against every exposed wall of the temple. A segment completely
+        // hidden inside blocks has its ends in a block, which check_solution rejects first.
+        for (const auto& wall : temple.getWalls()) {
+            if (segment_segment_intersection(segment, wall)) {
                 return true;
             }
         }
@@ -196,43 +212,69 @@ public:
         return false;
     }
 
+    // Above this many walls the occupancy pyramid beats testing every wall (it already
+    // wins by about 2x on the 152 walls of the CMC24 temple)
+    static constexpr size_t pyramidWallThreshold = 64;
+
     // Temple-Ray intersection function
     static double temple_ray_intersection(const Temple& temple, const Ray& ray) {
+        if (temple.getWalls().size() >= pyramidWallThreshold) {
+            return temple_ray_intersection_pyramid(temple, ray);
+        }
+
         // Initialize t_min with a large value (infinity)
         double t_min = std::numeric_limits<double>::infinity();
         const double epsilon = 1e-12;  // Small epsilon to avoid precision issues
 
-        // Iterate over each block in the temple
-        for (const Block& block : temple.getBlocks()) {
-            // Iterate over each side of the block
-            const std::tuple<Vector2, double, double>& s1 = block.s1;
-            const std::tuple<Vector2, double, double>& s2 = block.s2;
-            const std::tuple<Vector2, double, double>& s3 = block.s3;
-            const std::tuple<Vector2, double, double>& s4 = block.s4;
-
-            // Check each side of the block for intersection with the ray
-            for (const auto& segment : {s1, s2, s3, s4}) {
-                // Call the ray-segment intersection function
-                auto [caseType, t, u] = ray_segment_intersection(ray, segment);
+        // Only exposed walls can be the first hit of a ray travelling through free space
+        for (const auto& wall : temple.getWalls()) {
+            // Call the ray-segment intersection function
+            auto [caseType, t, u] = ray_segment_intersection(ray, wall);
 
-                // Update t_min if there's a valid intersection
-                if ((caseType == 2 || caseType == 3) && (t < t_min) && (t > epsilon)) {
-                    t_min = t;
-                }
+            // Update t_min if there's a valid intersection
+            if ((caseType == 2 || caseType == 3) && (t < t_min) && (t > epsilon)) {
+                t_min = t;
             }
         }
-        //std::cout << "Distance to temple wall " << t_min << std::endl;
         // Return the minimum intersection distance found
         return t_min;
     }
 
-    // Static function to check the solution validity
-    static bool check_solution(const Temple& temple, const Lamp& lamp, const std::vector<Mirror>& mirrors) {
+    // Temple-Ray intersection that walks the occupancy pyramid and only tests blocks next to the ray
+    static double temple_ray_intersection_pyramid(const Temple& temple, const Ray& ray) {
+        double t_min = std::numeric_limits<double>::infinity();
+        const double epsilon = 1e-12;  // Small epsilon to avoid precision issues
+        const double size = temple.getBlockSize();
+
+        temple.getPyramid().traverse(ray.origin, ray.direction, t_min, [&](int i, int j, double& t_best) {
+            // Same sides as the blocks built by Temple::loadTemple
+            Vector2 v1(i * size, j * size);
+            Vector2 v2((i + 1) * size, j * size);
+            Vector2 v3((i + 1) * size, (j + 1) * size);
+            Vector2 v4(i * size, (j + 1) * size);
+            for (const auto& segment : {std::make_tuple(v1, size, 0.0),
+                                        std::make_tuple(v2, size, M_PI / 2),
+                                        std::make_tuple(v3, size, M_PI),
+                                        std::make_tuple(v4, size, 3 * M_PI / 2)}) {
+                auto [caseType, t, u] = ray_segment_intersection(ray, segment);
+                if ((caseType == 2 || caseType == 3) && (t < t_best) && (t > epsilon)) {
+                    t_best = t;
+                }
+            }
+        });
+        return t_min;
+    }
+
+    // Static function to check the solution validity. With verbose == false nothing is
+    // printed, for optimizers that check many candidates.
+    static bool check_solution(const Temple& temple, const Lamp& lamp, const std::vector<Mirror>& mirrors, bool verbose = true) {
         // Check if the lamp is within the temple boundaries
         if (!(lamp.v.x >= 0 && lamp.v.y >= 0 && 
             lamp.v.x <= temple.getSize().first && lamp.v.y <= temple.getSize().second)) {
-            std::cerr << "ERROR! The lamp isn't placed within temple limits which is of size (" 
-                    << temple.getSize().first << ", " << temple.getSize().second << ")." << std::endl;
+            if (verbose) {
+                std::cerr << "ERROR! The lamp isn't placed within temple limits which is of size (" 
+                        << temple.getSize().first << ", " << temple.getSize().second << ")." << std::endl;
+            }
             return false;
         }
 
@@ -240,20 +282,26 @@ public:
         for (const auto& mirror : mirrors) {
             if (!(mirror.v1.x >= 0 && mirror.v1.y >= 0 && 
                 mirror.v1.x <= temple.getSize().first && mirror.v1.y <= temple.getSize().second)) {
-                std::cerr << "ERROR! Some mirror isn't placed within temple limits." << std::endl;
+                if (verbose) {
+                    std::cerr << "ERROR! Some mirror isn't placed within temple limits." << std::endl;
+                }
                 return false;
             }
 
             if (!(mirror.v2.x >= 0 && mirror.v2.y >= 0 && 
                 mirror.v2.x <= temple.getSize().first && mirror.v2.y <= temple.getSize().second)) {
-                std::cerr << "ERROR! Some mirror isn't placed within temple limits." << std::endl;
+                if (verbose) {
+                    std::cerr << "ERROR! Some mirror isn't placed within temple limits." << std::endl;
+                }
                 return false;
             }
         }
 
         // Check if the lamp is placed inside any building block
         if (pointInBlock(temple, lamp.v)) {
-            std::cerr << "ERROR! Lamp is placed in a building block." << std::endl;
+            if (verbose) {
+                std::cerr << "ERROR! Lamp is placed in a building block." << std::endl;
+            }
             return false;
         }
 
@@ -261,7 +309,9 @@ public:
         for (size_t i = 0; i < mirrors.size(); ++i) {
             const auto& mirror = mirrors[i];
             if (pointInBlock(temple, mirror.v1) || pointInBlock(temple, mirror.v2)) {
-                std::cerr << "ERROR! Mirror " << i << " has one of its ends inside a building block." << std::endl;
+                if (verbose) {
+                    std::cerr << "ERROR! Mirror " << i << " has one of its ends inside a building block." << std::endl;
+                }
                 return false;
             }
         }
@@ -270,56 +320,117 @@ public:
         for (size_t i = 0; i < mirrors.size(); ++i) {
             const auto& mirror = mirrors[i];
             if (temple_segment_intersection(temple, mirror.s)) {
-                std::cerr << "ERROR! Mirror " << i << " intersects with a building block." << std::endl;
+                if (verbose) {
+                    std::cerr << "ERROR! Mirror " << i << " intersects with a building block." << std::endl;
+                }
                 return false;
             }
         }
 
         // Check if any mirrors intersect with each other
-        for (size_t i = 0; i < mirrors.size() - 1; ++i) {
+        for (size_t i = 0; i + 1 < mirrors.size(); ++i) {
             const auto& mirror1 = mirrors[i];
             for (size_t j = i + 1; j < mirrors.size(); ++j) {
                 const auto& mirror2 = mirrors[j];
                 if (segment_segment_intersection(mirror1.s, mirror2.s)) {
-                    std::cerr << "ERROR! Mirrors " << i << " & " << j << " intersect." << std::endl;
+                    if (verbose) {
+                        std::cerr << "ERROR! Mirrors " << i << " & " << j << " intersect." << std::endl;
+                    }
                     return false;
                 }
             }
         }
 
         // If all checks pass
-        std::cerr << "The solution geometry is correct." << std::endl;
+        if (verbose) {
+            std::cerr << "The solution geometry is correct." << std::endl;
+        }
         return true;
     }
 
+    // Above this many mirrors raytrace builds a BVH instead of scanning every mirror per bounce
+    static constexpr size_t bvhMirrorThreshold = 32;
+
+    // A trace ends after this many segments per mirror (plus one). A beam can be trapped for
+    // good, e.g. between two parallel mirrors it meets head-on; no real path comes close.
+    static constexpr size_t traceSegmentsPerMirror = 4;
+
+    // Segments after which a trace with the given number of mirrors stops
+    static size_t max_trace_segments(const Temple& temple, size_t mirrorCount) {
+        return traceSegmentsPerMirror * (std::max(mirrorCount, (size_t)temple.getSpec().mirror_count) + 1);
+    }
+
     // Static function for ray tracing
     static Path raytrace(const Temple& temple, const Lamp& lamp, const std::vector<Mirror>& mirrors) {
+        if (mirrors.size() >= bvhMirrorThreshold) {
+            MirrorBVH bvh(mirrors);
+            return raytrace(temple, lamp, mirrors, bvh);
+        }
+        return raytrace(temple, lamp, mirrors, nullptr);
+    }
+
+    // Ray tracing with a caller-maintained BVH, e.g. refit after moving a single mirror
+    static Path raytrace(const Temple& temple, const Lamp& lamp, const std::vector<Mirror>& mirrors, const MirrorBVH& bvh) {
+        return raytrace(temple, lamp, mirrors, &bvh);
+    }
+
+    static Path raytrace(const Temple& temple, const Lamp& lamp, const std::vector<Mirror>& mirrors, const MirrorBVH* bvh) {
         Path path;
-        std::vector<int> hit_mirrors; // Stores indices of hit mirrors
-        double epsilon = 1e-12;       // Small threshold for intersection tests
-        
+
         // Initialize the ray from the lamp's position and direction
         Ray ray = { lamp.v, lamp.direction };
         path.points.push_back(lamp.v);
+        trace_from(temple, mirrors, bvh, ray, path, nullptr);
+        return path;
+    }
+
+    // Continue tracing a ray that starts at the last point of the path, appending the rest of
+    // the path. Tracing from points[k] in directions[k] of an earlier path gives exactly the same
+    // tail as the full trace, so a prefix that a change can't affect is reused as is. The path
+    // ends on a mirror instead of the temple when it reaches the segment cap (see
+    // traceSegmentsPerMirror), which counts the segments of the whole path.
+    static void trace_from(const Temple& temple, const std::vector<Mirror>& mirrors, const MirrorBVH* bvh, Ray ray, Path& path, TraceHits* hits) {
+        double epsilon = 1e-12;       // Small threshold for intersection tests
+        const size_t maxSegments = max_trace_segments(temple, mirrors.size());
 
         while (true) {
             double t_mirror = std::numeric_limits<double>::infinity();
             const Mirror* hit_mirror = nullptr; // The mirror that the ray hits
-            
-            // Check if the ray hits any mirrors
-            for (size_t i = 0; i < mirrors.size(); ++i) {
-                const auto& mirror = mirrors[i];
-                auto [caseType, t, u] = ray_segment_intersection(ray, mirror.s);
-                //std::cout << "Distance to mirror " << t << std::endl;
-                if ((caseType == 2 || caseType == 3) && (t < t_mirror) && (t > epsilon)) {
-                    t_mirror = t;
-                    hit_mirror = &mirror;
-                    hit_mirrors.push_back(i);
+            int hit_index = -1;                 // and its index
+
+            // Check where the ray would hit the temple
+            double t_temple = temple_ray_intersection(temple, ray);
+
+            if (bvh) {
+                // Only mirrors closer than the temple wall matter, so the wall distance bounds the search.
+                // Ties keep the lowest index, exactly like the linear scan below.
+                double t_bound = t_temple;
+                bvh->traverse(ray.origin, ray.direction, t_bound, [&](int i, double& t_best) {
+                    auto [caseType, t, u] = ray_segment_intersection(ray, mirrors[i].s);
+                    if ((caseType == 2 || caseType == 3) && (t > epsilon) &&
+                        (t < t_best || (t == t_best && hit_index >= 0 && i < hit_index))) {
+                        t_best = t;
+                        hit_index = i;
+                    }
+                });
+                if (hit_index >= 0) {
+                    t_mirror = t_bound;
+                    hit_mirror = &mirrors[hit_index];
+                }
+            } else {
+                // Check if the ray hits any mirrors
+                for (size_t i = 0; i < mirrors.size(); ++i) {
+                    const auto& mirror = mirrors[i];
+                    auto [caseType, t, u] = ray_segment_intersection(ray, mirror.s);
+                    //std::cout << "Distance to mirror " << t << std::endl;
+                    if ((caseType == 2 || caseType == 3) && (t < t_mirror) && (t > epsilon)) {
+                        t_mirror = t;
+                        hit_mirror = &mirror;
+                        hit_index = i;
+                    }
                 }
             }
             //std::cout << "Distance to mirror " << t_mirror << std::endl;
-            // Check where the ray would hit the temple
-            double t_temple = temple_ray_intersection(temple, ray);
 
             // Find the closest hit point (either the mirror or the temple)
             double t = std::min(t_mirror, t_temple);
@@ -328,9 +439,13 @@ public:
             // Update the ray's path with the new direction and point
             path.directions.push_back(ray.direction);
             path.points.push_back(hitting_point);
+            if (hits) {
+                hits->mirrors.push_back(t_mirror < t_temple && hit_mirror ? hit_index : -1);
+                hits->params.push_back(t);
+            }
 
             // If the ray hits a mirror, calculate the new direction
-            if (t_mirror < t_temple && hit_mirror) {
+            if (t_mirror < t_temple && hit_mirror && path.directions.size() < maxSegments) {
                 Vector2 normal = hit_mirror->normal;  // Assuming each mirror has a normal vector
                 ray = {
                     hitting_point,
@@ -343,22 +458,9 @@ public:
             // If the ray hits the temple, end the tracing
             break;
         }
-
-        return path;
     }
 
 
-
-private:
-    // Helper function to check if the point is within a specific block
-    static bool isWithinBlock(const Block& block, const Vector2& point) {
-        const Vector2& v1 = block.v1;  // Bottom-left corner (v1)
-        const Vector2& v3 = block.v3;  // Top-right corner (v3)
-
-        // Check if the point lies within the bounds of the block (v1 <= point <= v3)
-        return (v1.x <= point.x && point.x <= v3.x) &&
-               (v1.y <= point.y && point.y <= v3.y);
-    }
 };
 
 #endif // VALIDATION_H
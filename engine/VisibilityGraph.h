@@ -0,0 +1,700 @@
+#ifndef VISIBILITY_GRAPH_H
+#define VISIBILITY_GRAPH_H
+
+#include "../math/Vector2.h"
+#include "Temple.h"
+#include "Validation.h"
+#include "Scorer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct ChainSearchOptions {
+    int chains = 64;                 // Best chains to return
+    double seconds = 60;             // Budget of the depth-first search
+    long long maxNodes = 200000000;  // ... and its node limit
+};
+
+struct MeetOptions {
+    int width = 2000;         // Half-chains kept per depth on each side
+    int perJunction = 8;      // Backward half-chains kept per junction edge
+    int chains = 64;          // Best joined chains to return
+    int rescored = 4096;      // Joined chains, ranked by summed coverage, whose union is counted
+};
+
+// Candidate bounce points in the free space of a temple, joined when they see each
+// other, for combinatorial search over beam paths. A vertex is a point at which a
+// mirror of any angle fits clear of the blocks. A directed edge u -> v carries the
+// vacant pixels under the beam capsule of the segment [u, v] (coverage) and under
+// the capsule of the ray from u through v to the first wall (rayCoverage, used by
+// the last leg of a path).
+//
+// The graph depends only on the temple and the build parameters. It is built once
+// and saved as text; load() refuses a file built for another temple.
+class VisibilityGraph {
+public:
+    struct Edge {
+        int from;
+        int to;
+        long long coverage;
+        long long rayCoverage;
+        double rayLength; // From `from` through `to` to the first wall
+    };
+
+    // A path: vertices[0] is the lamp, then one vertex per mirror, then the aim point
+    struct Chain {
+        std::vector<int> vertices;
+        long long coverage; // Vacant pixels under the path's capsules, at the graph's resolution
+    };
+
+    // Sample vertices every `spacing` world units and join all mutually visible pairs;
+    // coverages are counted at pixelsPerUnit
+    void build(const Temple& temple, double spacing = 0.5, int pixelsPerUnit = 10) {
+        this->spacing = spacing;
+        resolution = pixelsPerUnit;
+        templeKey = keyOf(temple);
+        Scorer scorer(temple, pixelsPerUnit);
+        vacantCount = scorer.getVacantCount();
+
+        vertices.clear();
+        double clearance = temple.getSpec().mirror_length / 2;
+        auto size = temple.getSize();
+        for (double y = spacing / 2; y < size.second; y += spacing) {
+            for (double x = spacing / 2; x < size.first; x += spacing) {
+                if (clearOfBlocks(temple, Vector2(x, y), clearance)) {
+                    vertices.push_back(Vector2(x, y));
+                }
+            }
+        }
+
+        edges.clear();
+        for (int u = 0; u < (int)vertices.size(); ++u) {
+            for (int v = u + 1; v < (int)vertices.size(); ++v) {
+                Vector2 step = vertices[v] - vertices[u];
+                double length = step.magnitude();
+                Vector2 direction = step * (1 / length);
+                if (Validation::temple_ray_intersection(temple, Ray(vertices[u], direction)) < length) {
+                    continue;
+                }
+                long long coverage = capsuleCoverage(scorer, vertices[u], vertices[v]);
+                double forward = Validation::temple_ray_intersection(temple, Ray(vertices[u], direction));
+                double backward = Validation::temple_ray_intersection(temple, Ray(vertices[v], direction * -1));
+                edges.push_back({u, v, coverage, capsuleCoverage(scorer, vertices[u], vertices[u] + direction * forward), forward});
+                edges.push_back({v, u, coverage, capsuleCoverage(scorer, vertices[v], vertices[v] - direction * backward), backward});
+            }
+        }
+        buildAdjacency();
+    }
+
+    bool save(const std::string& filename) const {
+        std::ofstream file(filename);
+        if (!file) {
+            std::cerr << "ERROR! Can't write visibility graph " << filename << "." << std::endl;
+            return false;
+        }
+        file << "visibility_graph 1\n";
+        file << "temple " << templeKey << "\n";
+        file << "spacing " << std::setprecision(17) << spacing << "\n";
+        file << "resolution " << resolution << "\n";
+        file << "vacant " << vacantCount << "\n";
+        file << "vertices " << vertices.size() << "\n";
+        for (const Vector2& vertex : vertices) {
+            file << vertex.x << " " << vertex.y << "\n";
+        }
+        file << "edges " << edges.size() << "\n";
+        for (const Edge& edge : edges) {
+            file << edge.from << " " << edge.to << " " << edge.coverage << " " << edge.rayCoverage << " " << edge.rayLength << "\n";
+        }
+        return static_cast<bool>(file);
+    }
+
+    // Load a graph saved by save(); false (with a message) if it is unreadable or was
+    // built for a different temple
+    bool load(const std::string& filename, const Temple& temple) {
+        std::ifstream file(filename);
+        if (!file) {
+            std::cerr << "ERROR! Can't open visibility graph " << filename << "." << std::endl;
+            return false;
+        }
+        std::string word, key;
+        int version = 0;
+        size_t vertexCount = 0, edgeCount = 0;
+        if (!(file >> word >> version) || word != "visibility_graph" || version != 1 ||
+            !(file >> word >> key) || word != "temple" ||
+            !(file >> word >> spacing) || word != "spacing" ||
+            !(file >> word >> resolution) || word != "resolution" ||
+            !(file >> word >> vacantCount) || word != "vacant" ||
+            !(file >> word >> vertexCount) || word != "vertices") {
+            std::cerr << "ERROR! " << filename << " isn't a visibility graph." << std::endl;
+            return false;
+        }
+        if (key != keyOf(temple)) {
+            std::cerr << "ERROR! " << filename << " was built for a different temple." << std::endl;
+            return false;
+        }
+        templeKey = key;
+
+        vertices.resize(vertexCount);
+        for (Vector2& vertex : vertices) {
+            file >> vertex.x >> vertex.y;
+        }
+        if (!(file >> word >> edgeCount) || word != "edges") {
+            std::cerr << "ERROR! " << filename << " is truncated." << std::endl;
+            return false;
+        }
+        edges.resize(edgeCount);
+        for (Edge& edge : edges) {
+            file >> edge.from >> edge.to >> edge.coverage >> edge.rayCoverage >> edge.rayLength;
+        }
+        if (!file) {
+            std::cerr << "ERROR! " << filename << " is truncated." << std::endl;
+            return false;
+        }
+        buildAdjacency();
+        return true;
+    }
+
+    // Load the graph from the file if it fits the temple and the build parameters, otherwise
+    // build it and save it there
+    bool loadOrBuild(const std::string& filename, const Temple& temple, double spacing = 0.5, int pixelsPerUnit = 10) {
+        std::ifstream probe(filename);
+        std::string word, version, key;
+        if (probe && probe >> word >> version >> word >> key && word == "temple" && key != keyOf(temple)) {
+            std::cerr << filename << " was built for a different temple; rebuilding." << std::endl;
+        } else if (probe && load(filename, temple)) {
+            if (this->spacing == spacing && resolution == pixelsPerUnit) {
+                return true;
+            }
+            std::cerr << filename << " was built with spacing " << this->spacing << " at " << resolution
+                      << " pixels per unit; rebuilding." << std::endl;
+        }
+        build(temple, spacing, pixelsPerUnit);
+        return save(filename);
+    }
+
+    // Best simple paths with `mirrors` mirror vertices by covered vacant pixels, best first.
+    // A partial path is scored by the union of its capsules, as the scorer does; what the
+    // rest of the path can still add is bounded by the plain sum of edge coverages,
+    // maximised over all (not necessarily simple) continuations by dynamic programming
+    // over edges. Since a union never exceeds the sum, the depth-first branch-and-bound
+    // never prunes one of the best chains. Consecutive legs may not turn straight back.
+    // The search stops early on the budget, keeping the best chains found so far.
+    std::vector<Chain> longestChains(const Temple& temple, int mirrors, const ChainSearchOptions& options = ChainSearchOptions()) const {
+        std::vector<Chain> best;
+        if (mirrors < 0 || edges.empty()) {
+            return best;
+        }
+
+        // suffix[r][e]: most coverage after arriving over edge e with r more mirrors to place
+        // after e's target (which is a mirror); r == 0 leaves only the final ray
+        std::vector<std::vector<long long>> suffix(std::max(mirrors, 1), std::vector<long long>(edges.size(), -1));
+        for (size_t e = 0; e < edges.size(); ++e) {
+            for (int next : outgoing[edges[e].to]) {
+                if (canTurn(e, next)) {
+                    suffix[0][e] = std::max(suffix[0][e], edges[next].rayCoverage);
+                }
+            }
+        }
+        for (int r = 1; r < mirrors; ++r) {
+            for (size_t e = 0; e < edges.size(); ++e) {
+                for (int next : outgoing[edges[e].to]) {
+                    if (canTurn(e, next) && suffix[r - 1][next] >= 0) {
+                        suffix[r][e] = std::max(suffix[r][e], edges[next].coverage + suffix[r - 1][next]);
+                    }
+                }
+            }
+        }
+        // Bound on what leaving over edge e adds when `remaining` mirrors follow its target
+        auto bound = [&](int e, int remaining) -> long long {
+            if (remaining == 0) {
+                return edges[e].rayCoverage;
+            }
+            return suffix[remaining - 1][e] < 0 ? -1 : edges[e].coverage + suffix[remaining - 1][e];
+        };
+
+        // Mirrors are centred on their vertices; the beam must pass clear of all the others
+        const double clearance = temple.getSpec().mirror_length / 2;
+
+        // Lit spans of the current partial path per pixel row, with an undo journal
+        Scorer scorer(temple, resolution);
+        std::vector<std::vector<std::pair<int, int>>> rows(scorer.getPixelRows());
+        std::vector<long long> rowCounts(rows.size(), 0);
+        struct Change {
+            int row;
+            std::pair<int, int> span;
+            long long count;
+        };
+        std::vector<Change> journal;
+        auto addLeg = [&](int e, bool ray) {
+            long long gain = 0;
+            scorer.forEachCapsuleRow(vertices[edges[e].from], legEnd(e, ray), [&](int py, int colBegin, int colEnd) {
+                journal.push_back({py, {colBegin, colEnd}, rowCounts[py]});
+                rows[py].push_back({colBegin, colEnd});
+                long long count = scorer.vacantInSpans(py, rows[py]);
+                gain += count - rowCounts[py];
+                rowCounts[py] = count;
+            });
+            return gain;
+        };
+        auto undo = [&](size_t mark) {
+            while (journal.size() > mark) {
+                const Change& change = journal.back();
+                std::vector<std::pair<int, int>>& row = rows[change.row];
+                row.erase(std::find(row.begin(), row.end(), change.span));
+                rowCounts[change.row] = change.count;
+                journal.pop_back();
+            }
+        };
+
+        auto searchStart = std::chrono::steady_clock::now();
+        long long nodes = 0;
+        bool stopped = false;
+        std::vector<char> used(vertices.size(), 0);
+        std::vector<int> path;
+
+        // Incumbents kept sorted best first; new chains must beat the worst of them
+        auto threshold = [&]() {
+            return (int)best.size() < options.chains ? -1 : best.back().coverage;
+        };
+        auto record = [&](long long coverage) {
+            Chain chain{path, coverage};
+            auto at = std::upper_bound(best.begin(), best.end(), chain, [](const Chain& a, const Chain& b) {
+                return a.coverage > b.coverage;
+            });
+            best.insert(at, chain);
+            if ((int)best.size() > options.chains) {
+                best.pop_back();
+            }
+        };
+
+        // Try edge e as the next leg of a path covering `coverage` with `remaining` mirrors
+        // still to follow its target (the final ray if remaining < 0)
+        std::function<void(int, int, long long)> extend;
+        auto tryLeg = [&](int e, int remaining, long long coverage) {
+            if (stopped || (++nodes % 4096 == 0 && (nodes > options.maxNodes ||
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - searchStart).count() > options.seconds))) {
+                stopped = true;
+                return;
+            }
+            int target = edges[e].to;
+            if (!clearOfPath(e, remaining < 0, path, clearance)) {
+                return;
+            }
+            size_t mark = journal.size();
+            long long covered = coverage + addLeg(e, remaining < 0);
+            used[target] = 1;
+            path.push_back(target);
+            if (remaining < 0) {
+                if (covered > threshold()) {
+                    record(covered);
+                }
+            } else if (suffix[remaining][e] >= 0 && covered + suffix[remaining][e] > threshold()) {
+                extend(e, remaining, covered);
+            }
+            path.pop_back();
+            used[target] = 0;
+            undo(mark);
+        };
+        extend = [&](int e, int remaining, long long coverage) {
+            std::vector<std::pair<long long, int>> moves;
+            for (int next : outgoing[edges[e].to]) {
+                long long value = bound(next, remaining);
+                if (canTurn(e, next) && !used[edges[next].to] && value >= 0 && coverage + value > threshold()) {
+                    moves.push_back({value, next});
+                }
+            }
+            std::stable_sort(moves.begin(), moves.end(), [](const auto& a, const auto& b) {
+                return a.first > b.first;
+            });
+            for (const auto& [value, next] : moves) {
+                if (stopped || coverage + value <= threshold()) {
+                    break;
+                }
+                tryLeg(next, remaining - 1, coverage);
+            }
+        };
+
+        // First legs from the lamp, most promising first
+        std::vector<std::pair<long long, int>> firsts;
+        for (size_t e = 0; e < edges.size(); ++e) {
+            long long value = bound(e, mirrors);
+            if (value >= 0) {
+                firsts.push_back({value, (int)e});
+            }
+        }
+        std::stable_sort(firsts.begin(), firsts.end(), [](const auto& a, const auto& b) {
+            return a.first > b.first;
+        });
+        for (const auto& [value, e] : firsts) {
+            if (stopped || value <= threshold()) {
+                break;
+            }
+            int lamp = edges[e].from;
+            used[lamp] = 1;
+            path = {lamp};
+            tryLeg(e, mirrors - 1, 0);
+            used[lamp] = 0;
+        }
+        return best;
+    }
+
+    // Meet-in-the-middle search for paths with `mirrors` mirrors. The beam path is
+    // reversible, so forward halves (lamp + the first mirrors, built from the lamp) and
+    // backward halves (the last mirrors + the final ray, built from the walls inwards)
+    // are grown independently by beam search, each side keeping the `width` best by
+    // covered pixels per depth. Every forward half, continued over each leg leaving its
+    // last mirror, and every backward half, reached over each leg arriving at its first
+    // mirror, is indexed by that junction leg (its point and direction); halves sharing
+    // a junction leg join into a full chain when their vertices are disjoint, the beam
+    // can turn at both junction mirrors and all mirrors stay clear of the legs. Joined
+    // chains are ranked by the summed coverage of both halves and the junction leg, and
+    // the best are rescored by their exact union.
+    std::vector<Chain> meetInTheMiddle(const Temple& temple, int mirrors, const MeetOptions& options = MeetOptions()) const {
+        std::vector<Chain> result;
+        const int forwardMirrors = mirrors / 2;
+        const int backwardMirrors = mirrors - forwardMirrors;
+        if (forwardMirrors < 1 || edges.empty()) {
+            return result;
+        }
+        const double clearance = temple.getSpec().mirror_length / 2;
+        Scorer scorer(temple, resolution);
+        std::vector<std::vector<std::pair<int, int>>> rows(scorer.getPixelRows());
+
+        // A half is its vertices in beam order, the legs at both ends and its coverage
+        struct Half {
+            std::vector<int> vertices;
+            int firstEdge;
+            int lastEdge;
+            long long coverage;
+        };
+        auto keepBest = [&](std::vector<Half>& candidates, bool ray, size_t firstMirror, size_t endOffset) {
+            // Rank by the cheap bound, rescore the leaders by their union, keep `width`
+            std::stable_sort(candidates.begin(), candidates.end(), [](const Half& a, const Half& b) {
+                return a.coverage > b.coverage;
+            });
+            if ((int)candidates.size() > 4 * options.width) {
+                candidates.resize(4 * options.width);
+            }
+            for (Half& half : candidates) {
+                half.coverage = chainCoverage(scorer, rows, half.vertices, ray);
+            }
+            std::stable_sort(candidates.begin(), candidates.end(), [](const Half& a, const Half& b) {
+                return a.coverage > b.coverage;
+            });
+            std::vector<Half> kept;
+            for (Half& half : candidates) {
+                if ((int)kept.size() >= options.width) {
+                    break;
+                }
+                if (chainClear(half.vertices, firstMirror, half.vertices.size() - endOffset, ray, clearance)) {
+                    kept.push_back(std::move(half));
+                }
+            }
+            return kept;
+        };
+
+        // Forward halves: lamp, then forwardMirrors mirrors
+        std::vector<Half> forward;
+        for (size_t e = 0; e < edges.size(); ++e) {
+            forward.push_back({{edges[e].from, edges[e].to}, (int)e, (int)e, edges[e].coverage});
+        }
+        forward = keepBest(forward, false, 1, 0);
+        for (int depth = 1; depth < forwardMirrors; ++depth) {
+            std::vector<Half> next;
+            for (const Half& half : forward) {
+                for (int e : outgoing[half.vertices.back()]) {
+                    if (canTurn(half.lastEdge, e) && !contains(half.vertices, edges[e].to)) {
+                        Half longer = half;
+                        longer.vertices.push_back(edges[e].to);
+                        longer.lastEdge = e;
+                        longer.coverage += edges[e].coverage;
+                        next.push_back(std::move(longer));
+                    }
+                }
+            }
+            forward = keepBest(next, false, 1, 0);
+        }
+
+        // Backward halves: backwardMirrors mirrors, then the aim point of the final ray.
+        // Edges come in pairs, so e ^ 1 is the reverse of e.
+        std::vector<Half> backward;
+        for (size_t e = 0; e < edges.size(); ++e) {
+            backward.push_back({{edges[e].from, edges[e].to}, (int)e, (int)e, edges[e].rayCoverage});
+        }
+        backward = keepBest(backward, true, 0, 1);
+        for (int depth = 1; depth < backwardMirrors; ++depth) {
+            std::vector<Half> next;
+            for (const Half& half : backward) {
+                for (int reverse : outgoing[half.vertices.front()]) {
+                    int e = reverse ^ 1;
+                    if (canTurn(e, half.firstEdge) && !contains(half.vertices, edges[e].from)) {
+                        Half longer = half;
+                        longer.vertices.insert(longer.vertices.begin(), edges[e].from);
+                        longer.firstEdge = e;
+                        longer.coverage += edges[e].coverage;
+                        next.push_back(std::move(longer));
+                    }
+                }
+            }
+            backward = keepBest(next, true, 0, 1);
+        }
+
+        // Index the backward halves by the legs that can arrive at their first mirror
+        std::unordered_map<int, std::vector<int>> junctions;
+        for (int b = 0; b < (int)backward.size(); ++b) {
+            for (int reverse : outgoing[backward[b].vertices.front()]) {
+                int e = reverse ^ 1;
+                if (!canTurn(e, backward[b].firstEdge)) {
+                    continue;
+                }
+                std::vector<int>& list = junctions[e];
+                if ((int)list.size() < options.perJunction) {
+                    list.push_back(b); // Halves are sorted best first
+                }
+            }
+        }
+
+        // Join, ranking by the summed coverage
+        std::vector<Chain> joined;
+        std::vector<int> chain;
+        for (const Half& f : forward) {
+            for (int e : outgoing[f.vertices.back()]) {
+                auto found = junctions.find(e);
+                if (found == junctions.end() || !canTurn(f.lastEdge, e)) {
+                    continue;
+                }
+                for (int b : found->second) {
+                    const Half& h = backward[b];
+                    long long estimate = f.coverage + edges[e].coverage + h.coverage;
+                    if ((int)joined.size() >= options.rescored && estimate <= joined.back().coverage) {
+                        break;
+                    }
+                    chain = f.vertices;
+                    chain.insert(chain.end(), h.vertices.begin(), h.vertices.end());
+                    if (!distinct(chain) || !chainClear(chain, 1, chain.size() - 1, true, clearance)) {
+                        continue;
+                    }
+                    Chain candidate{chain, estimate};
+                    joined.insert(std::upper_bound(joined.begin(), joined.end(), candidate, [](const Chain& a, const Chain& c) {
+                        return a.coverage > c.coverage;
+                    }), candidate);
+                    if ((int)joined.size() > options.rescored) {
+                        joined.pop_back();
+                    }
+                }
+            }
+        }
+
+        for (Chain& candidate : joined) {
+            candidate.coverage = chainCoverage(scorer, rows, candidate.vertices, true);
+        }
+        std::stable_sort(joined.begin(), joined.end(), [](const Chain& a, const Chain& b) {
+            return a.coverage > b.coverage;
+        });
+        if ((int)joined.size() > options.chains) {
+            joined.resize(options.chains);
+        }
+        return joined;
+    }
+
+    // Coverage as a percentage of the vacant area
+    double percentage(long long coverage) const {
+        return vacantCount > 0 ? 100.0 * (double)coverage / (double)vacantCount : 0;
+    }
+
+    const std::vector<Vector2>& getVertices() const {
+        return vertices;
+    }
+
+    const std::vector<Edge>& getEdges() const {
+        return edges;
+    }
+
+private:
+    std::vector<Vector2> vertices;
+    std::vector<Edge> edges;
+    std::vector<std::vector<int>> outgoing; // Edge indices by source vertex
+    std::string templeKey;
+    double spacing = 0.5;
+    int resolution = 10;
+    long long vacantCount = 0;
+
+    // Where the beam along edge e ends: its target, or the wall for the final ray
+    Vector2 legEnd(int e, bool ray) const {
+        const Edge& edge = edges[e];
+        Vector2 from = vertices[edge.from];
+        Vector2 to = vertices[edge.to];
+        return ray ? from + (to - from) * (edge.rayLength / (to - from).magnitude()) : to;
+    }
+
+    // True if appending edge e to the path keeps every mirror (a disc of radius r around
+    // each vertex but the lamp and the aim point) off every leg not ending on it
+    bool clearOfPath(int e, bool ray, const std::vector<int>& path, double r) const {
+        const Vector2& from = vertices[edges[e].from];
+        Vector2 to = legEnd(e, ray);
+        for (size_t i = 1; i + 1 < path.size(); ++i) {
+            if (distanceToSegment(vertices[path[i]], from, to) <= r) {
+                return false;
+            }
+        }
+        if (!ray) {
+            const Vector2& mirror = vertices[edges[e].to];
+            for (size_t i = 0; i + 1 < path.size(); ++i) {
+                if (distanceToSegment(mirror, vertices[path[i]], vertices[path[i + 1]]) <= r) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Index of the edge from u to v, or -1 if they don't see each other
+    int edgeBetween(int u, int v) const {
+        for (int e : outgoing[u]) {
+            if (edges[e].to == v) {
+                return e;
+            }
+        }
+        return -1;
+    }
+
+    // True if the discs of radius r around chain[firstMirror .. endMirror) stay off every
+    // leg of the chain that doesn't start or end on them; the last leg runs on to the
+    // wall if `ray` is set
+    bool chainClear(const std::vector<int>& chain, size_t firstMirror, size_t endMirror, bool ray, double r) const {
+        for (size_t j = 0; j + 1 < chain.size(); ++j) {
+            Vector2 to = vertices[chain[j + 1]];
+            if (ray && j + 2 == chain.size()) {
+                int e = edgeBetween(chain[j], chain[j + 1]);
+                if (e < 0) {
+                    return false;
+                }
+                to = legEnd(e, true);
+            }
+            for (size_t i = firstMirror; i < endMirror; ++i) {
+                if (i != j && i != j + 1 && distanceToSegment(vertices[chain[i]], vertices[chain[j]], to) <= r) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Vacant pixels under the union of the chain's capsules, using rows as scratch
+    long long chainCoverage(const Scorer& scorer, std::vector<std::vector<std::pair<int, int>>>& rows,
+                            const std::vector<int>& chain, bool ray) const {
+        std::vector<int> touched;
+        for (size_t j = 0; j + 1 < chain.size(); ++j) {
+            Vector2 to = vertices[chain[j + 1]];
+            if (ray && j + 2 == chain.size()) {
+                int e = edgeBetween(chain[j], chain[j + 1]);
+                to = e < 0 ? to : legEnd(e, true);
+            }
+            scorer.forEachCapsuleRow(vertices[chain[j]], to, [&](int py, int colBegin, int colEnd) {
+                if (rows[py].empty()) {
+                    touched.push_back(py);
+                }
+                rows[py].push_back({colBegin, colEnd});
+            });
+        }
+        long long count = 0;
+        for (int py : touched) {
+            count += scorer.vacantInSpans(py, rows[py]);
+            rows[py].clear();
+        }
+        return count;
+    }
+
+    static bool contains(const std::vector<int>& list, int value) {
+        return std::find(list.begin(), list.end(), value) != list.end();
+    }
+
+    static bool distinct(std::vector<int> list) {
+        std::sort(list.begin(), list.end());
+        return std::adjacent_find(list.begin(), list.end()) == list.end();
+    }
+
+    static double distanceToSegment(const Vector2& p, const Vector2& a, const Vector2& b) {
+        Vector2 ab = b - a;
+        double lengthSquared = ab.dot(ab);
+        double t = lengthSquared > 0 ? std::min(std::max((p - a).dot(ab) / lengthSquared, 0.0), 1.0) : 0;
+        return (p - (a + ab * t)).magnitude();
+    }
+
+    void buildAdjacency() {
+        outgoing.assign(vertices.size(), {});
+        for (size_t e = 0; e < edges.size(); ++e) {
+            outgoing[edges[e].from].push_back(e);
+        }
+    }
+
+    // A mirror at the shared vertex can send the beam from edge `in` along edge `out`
+    // unless `out` leads straight back
+    bool canTurn(size_t in, size_t out) const {
+        const Edge& a = edges[in];
+        const Edge& b = edges[out];
+        if (b.to == a.from) {
+            return false;
+        }
+        Vector2 incoming = vertices[a.to] - vertices[a.from];
+        Vector2 leaving = vertices[b.to] - vertices[b.from];
+        double cosine = incoming.dot(leaving) / (incoming.magnitude() * leaving.magnitude());
+        return cosine > -1 + 1e-9;
+    }
+
+    // True if the square of half-size r around the point is inside the temple and touches no block
+    static bool clearOfBlocks(const Temple& temple, const Vector2& point, double r) {
+        auto size = temple.getSize();
+        if (point.x - r < 0 || point.y - r < 0 || point.x + r > size.first || point.y + r > size.second) {
+            return false;
+        }
+        double cell = temple.getBlockSize();
+        int i0 = (int)std::floor((point.x - r) / cell), i1 = (int)std::floor((point.x + r) / cell);
+        int j0 = (int)std::floor((point.y - r) / cell), j1 = (int)std::floor((point.y + r) / cell);
+        for (int j = j0; j <= j1; ++j) {
+            for (int i = i0; i <= i1; ++i) {
+                if (temple.isBlocked(i, j)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    static long long capsuleCoverage(const Scorer& scorer, const Vector2& a, const Vector2& b) {
+        long long count = 0;
+        std::vector<std::pair<int, int>> spans;
+        scorer.forEachCapsuleRow(a, b, [&](int py, int colBegin, int colEnd) {
+            spans.assign(1, {colBegin, colEnd});
+            count += scorer.vacantInSpans(py, spans);
+        });
+        return count;
+    }
+
+    // Identifies the temple and the problem parameters the coverages depend on
+    static std::string keyOf(const Temple& temple) {
+        const ProblemSpec& spec = temple.getSpec();
+        // FNV-1a of the layout, so the key doesn't change between builds
+        unsigned long long hash = 14695981039346656037ULL;
+        for (char c : spec.temple_string) {
+            if (c == 'O' || c == '.' || c == '\n') {
+                hash = (hash ^ (unsigned char)c) * 1099511628211ULL;
+            }
+        }
+        std::ostringstream key;
+        key << std::hex << hash << std::dec << "/" << temple.getShape().first << "x"
+            << temple.getShape().second << std::setprecision(17) << "/" << spec.block_size << "/" << spec.mirror_length
+            << "/" << spec.beam_half_width;
+        return key.str();
+    }
+};
+
+#endif // VISIBILITY_GRAPH_H
@@ -0,0 +1,251 @@
+#ifndef WAYPOINT_SOLVER_H
+#define WAYPOINT_SOLVER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "../math/Vector2.h"
+#include "Temple.h"
+#include "Lamp.h"
+#include "Mirror.h"
+#include "Validation.h"
+#include "ScoringContext.h"
+#include "ThreadPool.h"
+
+struct WaypointOptions
+{
+    int chains = 16;                   // Waypoint sequences improved side by side
+    int proposals = 8;                 // Mutants of every chain per generation
+    double seconds = 60;               // Wall-clock budget
+    int maxGenerations = 100000;
+    double moveSigma = 1.0;            // Gaussian waypoint move at the start, in world units...
+    double finalMoveSigma = 0.01;      // ...shrinking geometrically to this at the end of the budget
+    double resampleProbability = 0.1;  // Chance that a mutation draws a fresh point instead of moving one
+    int restartAfter = 200;            // Generations without gain before a chain (other than the best) restarts
+    int reportEvery = 50;              // Progress line every this many generations (0 for none)
+    unsigned long long seed = 1;
+};
+
+// Search over waypoint sequences instead of mirror poses. A solution is the lamp
+// position, one point per mirror and a final aiming point; the beam is meant to
+// run from point to point. A mirror centred on its waypoint reflects the
+// incoming direction into the outgoing one when it lies along their bisector,
+// so every angle follows in closed form and each mirror costs 2 search
+// dimensions instead of 3. As long as the segments between waypoints are clear,
+// every mirror is hit by construction.
+//
+// The search keeps several chains. Each generation every chain gets a few
+// mutants, each moving or redrawing one waypoint. All mutants are validated and
+// scored in one parallel batch, and a chain moves to its best mutant if that
+// scores at least as well. Mutants are drawn serially from one random stream, so
+// runs are reproducible for a given seed with any number of threads.
+class WaypointSolver
+{
+public:
+    WaypointSolver(const Temple &temple, ThreadPool &pool, std::vector<ScoringContext> &contexts,
+                   const WaypointOptions &options = WaypointOptions())
+        : temple(temple), pool(pool), contexts(contexts), options(options), rng(options.seed)
+    {
+    }
+
+    // Lamp and mirrors for the waypoints: points[0] is the lamp, points[1..] the mirror
+    // centres and the last point the final aim. False if two consecutive points coincide
+    // or the beam would have to turn straight back.
+    static bool toSolution(const std::vector<Vector2> &points, double mirrorLength, Lamp &lamp, std::vector<Mirror> &mirrors)
+    {
+        const size_t mirrorCount = points.size() - 2;
+        std::vector<Vector2> directions(points.size() - 1);
+        for (size_t i = 0; i + 1 < points.size(); ++i)
+        {
+            Vector2 step = points[i + 1] - points[i];
+            double length = step.magnitude();
+            if (length < 1e-9)
+            {
+                return false;
+            }
+            directions[i] = step * (1 / length);
+        }
+
+        lamp.updateLamp(points[0], std::atan2(directions[0].y, directions[0].x));
+        mirrors.clear();
+        for (size_t m = 0; m < mirrorCount; ++m)
+        {
+            // The mirror line runs along incoming + outgoing; its normal along outgoing - incoming
+            Vector2 along = directions[m] + directions[m + 1];
+            if (along.magnitude() < 1e-9)
+            {
+                return false;
+            }
+            double angle = std::atan2(along.y, along.x);
+            Vector2 direction(std::cos(angle), std::sin(angle));
+            mirrors.push_back(Mirror(points[m + 1] - direction * (mirrorLength / 2), angle, mirrorLength));
+        }
+        return true;
+    }
+
+    // Score of a waypoint sequence in the given context, 0 if it isn't a valid solution
+    double evaluate(const std::vector<Vector2> &points, ScoringContext &context) const
+    {
+        if (!toSolution(points, temple.getSpec().mirror_length, context.lamp, context.mirrors) ||
+            !Validation::check_solution(temple, context.lamp, context.mirrors, false))
+        {
+            return 0;
+        }
+        return context.evaluate();
+    }
+
+    // Search for the budget; leaves the best solution in lamp and mirrors and returns its score
+    double run(Lamp &lamp, std::vector<Mirror> &mirrors)
+    {
+        const int chainCount = std::max(1, options.chains);
+        const int proposals = std::max(1, options.proposals);
+        std::vector<std::vector<Vector2>> chains(chainCount);
+        for (std::vector<Vector2> &chain : chains)
+        {
+            chain = randomChain();
+        }
+        std::vector<double> scores;
+        scoreAll(chains, scores);
+        std::vector<int> stalled(chainCount, 0);
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::vector<Vector2>> mutants(chainCount * proposals);
+        std::vector<double> mutantScores;
+        int generation = 0;
+        for (; generation < options.maxGenerations; ++generation)
+        {
+            double progress = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / options.seconds;
+            if (progress >= 1)
+            {
+                break;
+            }
+            double sigma = options.moveSigma * std::pow(options.finalMoveSigma / options.moveSigma, progress);
+
+            for (int c = 0; c < chainCount; ++c)
+            {
+                for (int p = 0; p < proposals; ++p)
+                {
+                    mutants[c * proposals + p] = mutate(chains[c], sigma);
+                }
+            }
+            scoreAll(mutants, mutantScores);
+
+            int best = std::max_element(scores.begin(), scores.end()) - scores.begin();
+            for (int c = 0; c < chainCount; ++c)
+            {
+                int winner = c * proposals;
+                for (int p = 1; p < proposals; ++p)
+                {
+                    if (mutantScores[c * proposals + p] > mutantScores[winner])
+                    {
+                        winner = c * proposals + p;
+                    }
+                }
+                stalled[c] = mutantScores[winner] > scores[c] ? 0 : stalled[c] + 1;
+                if (mutantScores[winner] >= scores[c])
+                {
+                    chains[c].swap(mutants[winner]);
+                    scores[c] = mutantScores[winner];
+                }
+                else if (c != best && stalled[c] >= options.restartAfter)
+                {
+                    chains[c] = randomChain();
+                    scores[c] = evaluate(chains[c], contexts.front());
+                    stalled[c] = 0;
+                }
+            }
+
+            if (options.reportEvery > 0 && (generation + 1) % options.reportEvery == 0)
+            {
+                printf("Generation %d: best = %.4f, sigma = %.4f\n", generation + 1,
+                       *std::max_element(scores.begin(), scores.end()), sigma);
+            }
+        }
+
+        int best = std::max_element(scores.begin(), scores.end()) - scores.begin();
+        toSolution(chains[best], temple.getSpec().mirror_length, lamp, mirrors);
+        printf("Waypoint search finished after %d generations: best = %.4f\n", generation, scores[best]);
+        return scores[best];
+    }
+
+private:
+    const Temple &temple;
+    ThreadPool &pool;
+    std::vector<ScoringContext> &contexts;
+    WaypointOptions options;
+    std::mt19937_64 rng;
+
+    void scoreAll(const std::vector<std::vector<Vector2>> &chains, std::vector<double> &scores)
+    {
+        scores.resize(chains.size());
+        pool.parallelFor(chains.size(), [&](int worker, size_t i)
+                         { scores[i] = evaluate(chains[i], contexts[worker]); });
+    }
+
+    // Uniform point in a uniformly chosen vacant cell
+    Vector2 randomVacantPoint()
+    {
+        auto [width, height] = temple.getShape();
+        double cell = temple.getBlockSize();
+        std::uniform_int_distribution<int> column(0, width - 1), row(0, height - 1);
+        std::uniform_real_distribution<double> within(0, cell);
+        for (;;)
+        {
+            int i = column(rng), j = row(rng);
+            if (!temple.isBlocked(i, j))
+            {
+                return Vector2(i * cell + within(rng), j * cell + within(rng));
+            }
+        }
+    }
+
+    // True if the straight segment from a to b doesn't touch a wall
+    bool visible(const Vector2 &a, const Vector2 &b) const
+    {
+        Vector2 step = b - a;
+        double length = step.magnitude();
+        if (length < 1e-9)
+        {
+            return false;
+        }
+        return Validation::temple_ray_intersection(temple, Ray(a, step * (1 / length))) >= length;
+    }
+
+    // Waypoints drawn one after another, each visible from the previous one when possible
+    std::vector<Vector2> randomChain()
+    {
+        std::vector<Vector2> points{randomVacantPoint()};
+        const int count = temple.getSpec().mirror_count + 2;
+        while ((int)points.size() < count)
+        {
+            Vector2 next = randomVacantPoint();
+            for (int attempt = 0; attempt < 100 && !visible(points.back(), next); ++attempt)
+            {
+                next = randomVacantPoint();
+            }
+            points.push_back(next);
+        }
+        return points;
+    }
+
+    std::vector<Vector2> mutate(const std::vector<Vector2> &chain, double sigma)
+    {
+        std::vector<Vector2> mutant = chain;
+        Vector2 &point = mutant[std::uniform_int_distribution<size_t>(0, chain.size() - 1)(rng)];
+        if (std::uniform_real_distribution<double>(0, 1)(rng) < options.resampleProbability)
+        {
+            point = randomVacantPoint();
+            return mutant;
+        }
+        auto [width, height] = temple.getSize();
+        std::normal_distribution<double> gauss(0, sigma);
+        point.x = std::min(std::max(point.x + gauss(rng), 0.0), (double)width);
+        point.y = std::min(std::max(point.y + gauss(rng), 0.0), (double)height);
+        return mutant;
+    }
+};
+
+#endif // WAYPOINT_SOLVER_H
@@ -1,5 +1,6 @@
 #include <iostream>
 #include "math/Vector2.h"
+#include "engine/ProblemSpec.h"
 #include "engine/Temple.h"
 #include "engine/Mirror.h"
 #include "engine/Lamp.h"
@@ -11,11 +12,20 @@
 
 // #define SOLVER
 
-int main()
+int main(int argc, char *argv[])
 {
+    // PROBLEM ----------------------------
+    // The CMC24 problem by default, or a spec file given on the command line
+    ProblemSpec spec;
+    if (argc > 1 && !ProblemSpec::loadFromFile(argv[1], spec))
+    {
+        std::cerr << "Failed to load the problem spec!" << std::endl;
+        return 1;
+    }
+    // ------------------------------------
 
     // TEMPLE -----------------------------
-    Temple temple;              // Create a constant Temple object
+    Temple temple(spec);        // Compile the temple geometry from the spec
     temple.printTempleString(); // Print the temple string
     std::cout << "Block size: " << temple.getBlockSize() << std::endl;
     // ------------------------------------
@@ -28,6 +38,18 @@ int main()
     Solver solver(&temple, &lamp, mirrors, &path, 1);
     solver.runGreedy();
     // solver.runPSO();
+    // solver.runAnnealing(60);
+    // solver.runTempering(60);
+    // solver.runTabu(60);
+    // solver.runCMAES(60);
+    // solver.runDE(60);
+    // solver.runIslands(60);
+    // solver.runBeam(8);
+    // solver.runPolish(60);
+    // solver.runWaypoints(60);
+    // solver.runVisibilityGraph("visibility.graph");
+    // solver.runMeetInTheMiddle("visibility.graph");
+    // solver.runBranchAndBound(2);
 #else
     // Load a solution
     /*  std::vector<std::vector<double>> cmc24_solution = {
@@ -131,7 +153,7 @@ int main()
       };*/
 
     // Call load_solution to process the solution matrix
-    bool success = Validation::load_solution(cmc24_solution, lamp, mirrors);
+    bool success = Validation::load_solution(cmc24_solution, lamp, mirrors, spec);
     // Check if the solution loaded successfully
     if (!success)
     {
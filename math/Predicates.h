@@ -0,0 +1,173 @@
+#ifndef PREDICATES_H
+#define PREDICATES_H
+
+#include "Vector2.h"
+#include <cmath>
+#include <cfloat>
+#include <limits>
+
+// Robust signs of small polynomial expressions (cross products and their
+// differences) for the intersection code. Every expression is written as a sum
+// of products of input coordinates; the sum is first evaluated in plain doubles
+// and its sign is trusted when it exceeds a forward error bound. Only when the
+// sign is uncertain, the sum is recomputed exactly with floating point
+// expansions (Shewchuk's arithmetic), so the usual case costs about as much as
+// the naive formula.
+namespace Predicates {
+
+namespace detail {
+
+// a + b = x + y exactly
+inline void twoSum(double a, double b, double& x, double& y) {
+    x = a + b;
+    double bVirtual = x - a;
+    double aVirtual = x - bVirtual;
+    double bRoundoff = b - bVirtual;
+    double aRoundoff = a - aVirtual;
+    y = aRoundoff + bRoundoff;
+}
+
+// a = hi + lo, both with at most 26 significant bits
+inline void split(double a, double& hi, double& lo) {
+    const double splitter = 134217729.0; // 2^27 + 1
+    double c = splitter * a;
+    double aBig = c - a;
+    hi = c - aBig;
+    lo = a - hi;
+}
+
+// a * b = x + y exactly
+inline void twoProduct(double a, double b, double& x, double& y) {
+    x = a * b;
+    double aHi, aLo, bHi, bLo;
+    split(a, aHi, aLo);
+    split(b, bHi, bLo);
+    double err1 = x - aHi * bHi;
+    double err2 = err1 - aLo * bHi;
+    double err3 = err2 - aHi * bLo;
+    y = aLo * bLo - err3;
+}
+
+// Add b to the nonoverlapping expansion e (smallest component first), dropping zeros
+inline int growExpansion(double* e, int length, double b) {
+    double q = b;
+    int out = 0;
+    for (int i = 0; i < length; ++i) {
+        double sum, error;
+        twoSum(q, e[i], sum, error);
+        q = sum;
+        if (error != 0) {
+            e[out++] = error;
+        }
+    }
+    if (q != 0) {
+        e[out++] = q;
+    }
+    return out;
+}
+
+inline int sign(double value) {
+    return (value > 0) - (value < 0);
+}
+
+} // namespace detail
+
+// Exact sign of a[0] * b[0] + ... + a[n - 1] * b[n - 1], for n <= 8
+inline int sumOfProductsSign(const double* a, const double* b, int n) {
+    double sum = 0;
+    double magnitude = 0;
+    for (int i = 0; i < n; ++i) {
+        double product = a[i] * b[i];
+        sum += product;
+        magnitude += std::fabs(product);
+    }
+
+    // Each product and each addition is off by at most half an ulp of its magnitude
+    double bound = (2 * n + 1) * DBL_EPSILON * magnitude;
+    if (sum > bound || -sum > bound) {
+        return detail::sign(sum);
+    }
+    if (magnitude == 0) {
+        return 0;
+    }
+
+    // Exact fallback
+    double expansion[32];
+    int length = 0;
+    for (int i = 0; i < n; ++i) {
+        double hi, lo;
+        detail::twoProduct(a[i], b[i], hi, lo);
+        length = detail::growExpansion(expansion, length, lo);
+        length = detail::growExpansion(expansion, length, hi);
+    }
+    return length > 0 ? detail::sign(expansion[length - 1]) : 0;
+}
+
+// sign(a x b)
+inline int crossSign(const Vector2& a, const Vector2& b) {
+    const double left[] = {a.x, -a.y};
+    const double right[] = {b.y, b.x};
+    return sumOfProductsSign(left, right, 2);
+}
+
+// sign((q - p) x r), without rounding q - p
+inline int diffCrossSign(const Vector2& q, const Vector2& p, const Vector2& r) {
+    const double left[] = {q.x, -p.x, -q.y, p.y};
+    const double right[] = {r.y, r.y, r.x, r.x};
+    return sumOfProductsSign(left, right, 4);
+}
+
+// sign(r x s - (q - p) x w), i.e. the sign of (rs - qpw) used to compare a ratio qpw / rs with 1
+inline int crossMinusDiffCrossSign(const Vector2& r, const Vector2& s, const Vector2& q, const Vector2& p, const Vector2& w) {
+    const double left[] = {r.x, -r.y, -q.x, p.x, q.y, -p.y};
+    const double right[] = {s.y, s.x, w.y, w.y, w.x, w.x};
+    return sumOfProductsSign(left, right, 6);
+}
+
+// Floating point value of a ratio, nudged so that comparing it with 0 and 1 gives the
+// exact answers. signFromZero and signFromOne are the exact signs of ratio and ratio - 1.
+inline double consistentRatio(double value, int signFromZero, int signFromOne) {
+    if (signFromZero == 0) {
+        return 0;
+    }
+    if (signFromOne == 0) {
+        return 1;
+    }
+    if (signFromZero < 0) {
+        return value < 0 ? value : -std::numeric_limits<double>::denorm_min();
+    }
+    if (signFromOne > 0) {
+        return value > 1 ? value : std::nextafter(1.0, 2.0);
+    }
+    // Strictly between 0 and 1
+    if (value <= 0) {
+        return std::numeric_limits<double>::denorm_min();
+    }
+    if (value >= 1) {
+        return std::nextafter(1.0, 0.0);
+    }
+    return value;
+}
+
+// Vector from the start to the end of a segment given as (length, angle). The
+// axis-aligned angles used for temple blocks give exact vectors, otherwise
+// cos(pi / 2) = 6e-17 would tilt every vertical block side.
+inline Vector2 segmentVector(double length, double angle) {
+    if (angle == 0) {
+        return {length, 0};
+    }
+    if (angle == M_PI / 2) {
+        return {0, length};
+    }
+    if (angle == M_PI) {
+        return {-length, 0};
+    }
+    if (angle == 3 * M_PI / 2) {
+        return {0, -length};
+    }
+    return {length * std::cos(angle), length * std::sin(angle)};
+}
+
+} // namespace Predicates
+
+#endif // PREDICATES_H
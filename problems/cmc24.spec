@@ -0,0 +1,7 @@
+# The official CMC24 problem. Copy this file and change values for what-if studies,
+# then run: temple_renderer problems/my_study.spec
+temple_file cmc24.temple
+block_size 1
+mirror_count 8
+mirror_length 0.5
+beam_half_width 1.0
@@ -131,7 +131,7 @@ public:
         {
             // Draw circles for each point in the path
             sf::Color lightColor(255, 178, 153, 255); // Light color with full opacity
-            double halfWidth = 1.0;
+            double halfWidth = temple->getSpec().beam_half_width;
 
             for (const Vector2 &point : path->points)
             {